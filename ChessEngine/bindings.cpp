@@ -1,11 +1,981 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/numpy.h>
+#include <pybind11/stl.h>
 
+#include <algorithm>
+#include <mutex>
+
+#include "board_batch.h"
+#include "book.h"
 #include "chess.h"
+#include "evaluate.h"
+#include "mcts.h"
+#include "packed.h"
+#include "pgn.h"
+#include "policy.h"
+#include "rollout.h"
+#include "search.h"
+#include "selfplay.h"
+#include "syzygy.h"
+#include "tensor.h"
+#include "thread_pool.h"
 
 namespace py = pybind11;
 
+// positions handed to one pool task, each task parses into its own board
+constexpr size_t BATCH_GRAIN = 256;
+
+static void parseOrRaise(Board& board, std::string_view fen) {
+    FENError error = board.parseFEN(fen);
+    if (error != FEN_OK)
+        throw py::value_error(std::string("invalid FEN: ") + fenErrorString(error));
+}
+
+// positions of a batch call: FEN strings or an (N, 32) uint8 array of packed records.
+// Positions that fail to load are raised as the first one once the GIL is back; a
+// failed position is left as the previous one of the same task
+class BatchPositions {
+public:
+    explicit BatchPositions(py::handle positions) {
+        if (!py::isinstance<py::array_t<uint8_t>>(positions)) {
+            fens = positions.cast<std::vector<std::string>>();
+            count = fens.size();
+            return;
+        }
+        records = py::array_t<uint8_t, py::array::c_style>::ensure(positions);
+        if (records.ndim() != 2 || records.shape(1) != sizeof(PackedPosition))
+            throw py::value_error("packed positions must be an (N, 32) uint8 array");
+        packed = records.data();
+        count = static_cast<size_t>(records.shape(0));
+    }
+
+    size_t size() const { return count; }
+
+    void load(Board& board, size_t i) {
+        FENError error;
+        if (packed) {
+            // records of a sliced buffer need not be aligned
+            PackedPosition record;
+            memcpy(&record, packed + i * sizeof(PackedPosition), sizeof(record));
+            error = unpackPosition(record, board);
+        }
+        else {
+            error = board.parseFEN(fens[i]);
+        }
+        if (error == FEN_OK)
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (i < index)
+            index = i, first = error;
+    }
+
+    void raise() const {
+        if (first != FEN_OK)
+            throw py::value_error(std::string(packed ? "invalid packed position" : "invalid FEN")
+                + " at index " + std::to_string(index) + ": " + fenErrorString(first));
+    }
+
+private:
+    std::vector<std::string> fens;
+    py::array_t<uint8_t, py::array::c_style> records;
+    const uint8_t* packed = nullptr;
+    size_t count = 0;
+
+    std::mutex mutex;
+    size_t index = SIZE_MAX;
+    FENError first = FEN_OK;
+};
+
+// caller-provided C-contiguous float32 / uint8 buffer of shape ([N,] C, 8, 8)
+struct TensorOut {
+    void* data;
+    bool isFloat;
+    size_t stride;   // values per position
+};
+
+static TensorOut tensorBuffer(py::array& out, py::ssize_t count, bool attacks, bool batched) {
+    py::ssize_t planes = tensorPlanes(attacks);
+    bool isFloat = out.dtype().is(py::dtype::of<float>());
+    if (!isFloat && !out.dtype().is(py::dtype::of<uint8_t>()))
+        throw py::type_error("out must be a float32 or uint8 array");
+    if (!out.writeable() || !(out.flags() & py::array::c_style))
+        throw py::value_error("out must be writeable and C-contiguous");
+
+    std::vector<py::ssize_t> shape = { planes, 8, 8 };
+    if (batched)
+        shape.insert(shape.begin(), count);
+    if (out.ndim() != static_cast<py::ssize_t>(shape.size())
+        || !std::equal(shape.begin(), shape.end(), out.shape()))
+        throw py::value_error("out must have shape " + std::string(batched ? "(N, " : "(")
+            + std::to_string(planes) + ", 8, 8)");
+
+    return { out.mutable_data(), isFloat, static_cast<size_t>(planes) * 64 };
+}
+
+static void encodeInto(const TensorOut& out, size_t index, const Board& board, bool attacks) {
+    if (out.isFloat)
+        encodeBoard(board, static_cast<float*>(out.data) + index * out.stride, attacks);
+    else
+        encodeBoard(board, static_cast<uint8_t*>(out.data) + index * out.stride, attacks);
+}
+
+static void encodePositions(BatchPositions& positions, py::array& out, bool attacks) {
+    TensorOut buffer = tensorBuffer(out, static_cast<py::ssize_t>(positions.size()), attacks, true);
+    {
+        py::gil_scoped_release release;
+        ThreadPool::global()->parallelFor(positions.size(), BATCH_GRAIN, [&](size_t begin, size_t end) {
+            Board board;
+            for (size_t i = begin; i < end; i++) {
+                positions.load(board, i);
+                encodeInto(buffer, i, board, attacks);
+            }
+        });
+    }
+    positions.raise();
+}
+
+static bool isLegalMove(Board& board, Move move) {
+    MoveStore m(move);
+    return move && board.findMove(m.getSource(), m.getTarget(), m.getPromoted()) == move;
+}
+
+// numpy unicode array of the given shape holding strings of up to width characters
+static py::array stringArray(const std::vector<py::ssize_t>& shape, size_t width) {
+    return py::array(py::dtype("<U" + std::to_string(width)), shape);
+}
+
+// the UCS4 slot of element index, padded with zeros as numpy expects
+static void putString(uint32_t* data, size_t width, size_t index, const char* str, size_t length) {
+    uint32_t* out = data + index * width;
+    for (size_t i = 0; i < width; i++)
+        out[i] = i < length ? static_cast<uint8_t>(str[i]) : 0;
+}
+
+// records of a packed dataset as an (N, 32) uint8 array, negative indices count from the end
+static py::array_t<uint8_t> gatherRecords(const PackedReader& reader, py::array_t<int64_t, py::array::c_style | py::array::forcecast> indices) {
+    if (indices.ndim() != 1)
+        throw py::value_error("indices must be one-dimensional");
+    py::ssize_t count = indices.shape(0);
+    py::ssize_t size = static_cast<py::ssize_t>(reader.size());
+    py::array_t<uint8_t> records({ count, static_cast<py::ssize_t>(sizeof(PackedPosition)) });
+    const int64_t* in = indices.data();
+    PackedPosition* out = reinterpret_cast<PackedPosition*>(records.mutable_data());
+    for (py::ssize_t i = 0; i < count; i++) {
+        py::ssize_t index = in[i] < 0 ? in[i] + size : in[i];
+        if (index < 0 || index >= size)
+            throw py::index_error("record index " + std::to_string(in[i]) + " out of range");
+        out[i] = reader[index];
+    }
+    return records;
+}
+
+// caller-provided C-contiguous bool / uint8 buffer of shape ([N,] 4672) or ([N,] 73, 8, 8)
+static uint8_t* maskBuffer(py::array& out, py::ssize_t count, bool batched) {
+    if (!out.dtype().is(py::dtype::of<bool>()) && !out.dtype().is(py::dtype::of<uint8_t>()))
+        throw py::type_error("out must be a bool or uint8 array");
+    if (!out.writeable() || !(out.flags() & py::array::c_style))
+        throw py::value_error("out must be writeable and C-contiguous");
+
+    py::ssize_t lead = batched ? 1 : 0;
+    bool flat = out.ndim() == lead + 1 && out.shape(lead) == POLICY_SIZE;
+    bool planes = out.ndim() == lead + 3 && out.shape(lead) == POLICY_PLANES
+        && out.shape(lead + 1) == 8 && out.shape(lead + 2) == 8;
+    if ((!flat && !planes) || (batched && out.shape(0) != count))
+        throw py::value_error(std::string("out must have shape ") + (batched ? "(N, 4672) or (N, 73, 8, 8)" : "(4672,) or (73, 8, 8)"));
+
+    return static_cast<uint8_t*>(out.mutable_data());
+}
+
+static SearchLimits analysisLimits(int multiPV, int depth, uint64_t nodes, int64_t movetime) {
+    if (!depth && !nodes && !movetime)
+        throw py::value_error("analysis needs a depth, nodes or movetime limit");
+
+    SearchLimits limits;
+    limits.multiPV = std::max(multiPV, 1);
+    if (depth)
+        limits.depth = std::min(depth, MAX_PLY - 1);
+    limits.nodes = nodes;
+    limits.movetime = movetime;
+    return limits;
+}
+
+static py::dict statsToDict(const SearchStats& stats) {
+    py::dict d;
+    d["nodes"] = stats.nodes;
+    d["qnodes"] = stats.qnodes;
+    d["tt_probes"] = stats.ttProbes;
+    d["tt_hits"] = stats.ttHits;
+    d["tt_cutoffs"] = stats.ttCutoffs;
+    d["beta_cutoffs"] = stats.betaCutoffs;
+    d["first_move_cutoffs"] = stats.firstMoveCutoffs;
+    d["null_move_tries"] = stats.nullMoveTries;
+    d["null_move_cutoffs"] = stats.nullMoveCutoffs;
+    d["lmr_reductions"] = stats.lmrReductions;
+    d["lmr_researches"] = stats.lmrResearches;
+    d["branching_factor"] = py::array_t<double>(stats.branchingFactor.size(), stats.branchingFactor.data());
+    return d;
+}
+
+// lines of every position as arrays [position][line], pvs [position][line][ply] padded
+// with 0 moves; a single position drops the leading dimension
+static py::dict linesToArrays(const std::vector<std::vector<PVLine>>& results, py::ssize_t multiPV, bool batch) {
+    py::ssize_t count = static_cast<py::ssize_t>(results.size());
+    py::ssize_t plies = 1;
+    for (const auto& lines : results)
+        for (const PVLine& line : lines)
+            plies = std::max(plies, static_cast<py::ssize_t>(line.pv.size()));
+
+    py::array_t<uint32_t> moves({ count, multiPV });
+    py::array_t<int32_t> scores({ count, multiPV });
+    py::array_t<int32_t> depths({ count, multiPV });
+    py::array_t<int32_t> lengths({ count, multiPV });
+    py::array_t<uint32_t> pvs({ count, multiPV, plies });
+    std::fill_n(moves.mutable_data(), moves.size(), 0);
+    std::fill_n(scores.mutable_data(), scores.size(), 0);
+    std::fill_n(depths.mutable_data(), depths.size(), 0);
+    std::fill_n(lengths.mutable_data(), lengths.size(), 0);
+    std::fill_n(pvs.mutable_data(), pvs.size(), 0);
+
+    auto m = moves.mutable_unchecked<2>();
+    auto s = scores.mutable_unchecked<2>();
+    auto d = depths.mutable_unchecked<2>();
+    auto l = lengths.mutable_unchecked<2>();
+    auto p = pvs.mutable_unchecked<3>();
+    for (py::ssize_t i = 0; i < count; i++)
+        for (py::ssize_t k = 0; k < static_cast<py::ssize_t>(results[i].size()) && k < multiPV; k++) {
+            const PVLine& line = results[i][k];
+            m(i, k) = line.pv.empty() ? 0 : line.pv[0];
+            s(i, k) = line.score;
+            d(i, k) = line.depth;
+            l(i, k) = static_cast<int32_t>(line.pv.size());
+            for (py::ssize_t ply = 0; ply < static_cast<py::ssize_t>(line.pv.size()); ply++)
+                p(i, k, ply) = line.pv[ply];
+        }
+
+    py::dict out;
+    if (batch) {
+        out["moves"] = moves, out["scores"] = scores, out["depths"] = depths;
+        out["pv_lengths"] = lengths, out["pvs"] = pvs;
+    }
+    else {
+        out["moves"] = moves.reshape({ multiPV });
+        out["scores"] = scores.reshape({ multiPV });
+        out["depths"] = depths.reshape({ multiPV });
+        out["pv_lengths"] = lengths.reshape({ multiPV });
+        out["pvs"] = pvs.reshape({ multiPV, plies });
+    }
+    return out;
+}
+
 PYBIND11_MODULE(chess_engine, m) {
+    m.def("load_nnue", &nnueLoad, py::arg("path"),
+        "Load NNUE weights from a local file, returns False if the file is missing or malformed");
+    m.def("nnue_simd", &nnueSimdLevel,
+        "Instruction set selected at runtime for the NNUE kernels");
+    m.def("pawn_table_stats", [] {
+        PawnTableStats stats = pawnTableStats();
+        py::dict d;
+        d["probes"] = stats.probes;
+        d["hits"] = stats.hits;
+        d["hit_rate"] = stats.probes ? double(stats.hits) / stats.probes : 0.0;
+        return d;
+        }, "Pawn hash table counters of the calling thread");
+    m.def("init_syzygy", &syzygyInit, py::arg("paths"),
+        "Register the Syzygy tables found in the given directories, returns the number of files");
+    m.def("init_book", &bookInit, py::arg("path"),
+        "Memory-map a Polyglot opening book, returns False if the file is missing or malformed");
+
+    m.def("set_batch_threads", &ThreadPool::setGlobalThreads, py::arg("threads"),
+        "Threads used by the batch_* functions, 0 for one per hardware thread");
+    m.def("batch_legal_moves", [](py::object fens) {
+        BatchPositions positions(fens);
+        size_t count = positions.size();
+        std::vector<std::vector<Move>> chunkMoves((count + BATCH_GRAIN - 1) / BATCH_GRAIN);
+        py::array_t<int64_t> offsets(count + 1);
+        py::array_t<bool> inCheck(count);
+        int64_t* offset = offsets.mutable_data();
+        bool* check = inCheck.mutable_data();
+        {
+            py::gil_scoped_release release;
+            ThreadPool::global()->parallelFor(count, BATCH_GRAIN, [&](size_t begin, size_t end) {
+                Board board;
+                std::vector<Move>& out = chunkMoves[begin / BATCH_GRAIN];
+                for (size_t i = begin; i < end; i++) {
+                    positions.load(board, i);
+                    MoveList moves = board.legalMoves();
+                    out.insert(out.end(), moves.moves, moves.moves + moves.size());
+                    offset[i + 1] = moves.size();
+                    check[i] = board.inCheck();
+                }
+            });
+            offset[0] = 0;
+            for (size_t i = 0; i < count; i++)
+                offset[i + 1] += offset[i];
+        }
+        positions.raise();
+
+        // chunks are in position order, so the moves concatenate into place
+        py::array_t<uint32_t> moves(offset[count]);
+        uint32_t* out = moves.mutable_data();
+        for (const std::vector<Move>& chunk : chunkMoves)
+            out = std::copy(chunk.begin(), chunk.end(), out);
+
+        py::dict d;
+        d["moves"] = moves;
+        d["offsets"] = offsets;
+        d["in_check"] = inCheck;
+        return d;},
+        py::arg("fens"),
+        "Legal moves of every position (FEN strings or an (N, 32) uint8 array of packed records): moves[offsets[i]:offsets[i + 1]] belong to fens[i]; also in_check flags");
+    m.def("batch_status", [](py::object fens) {
+        BatchPositions positions(fens);
+        py::array_t<uint8_t> status(static_cast<py::ssize_t>(positions.size()));
+        uint8_t* out = status.mutable_data();
+        {
+            py::gil_scoped_release release;
+            ThreadPool::global()->parallelFor(positions.size(), BATCH_GRAIN, [&](size_t begin, size_t end) {
+                Board board;
+                for (size_t i = begin; i < end; i++) {
+                    positions.load(board, i);
+                    out[i] = board.status();
+                }
+            });
+        }
+        positions.raise();
+        return status;},
+        py::arg("fens"),
+        "GameStatus code of every position (FEN strings or packed records), see Board.status");
+
+    m.def("batch_states", [](py::object fens) {
+        BatchPositions positions(fens);
+        py::ssize_t count = static_cast<py::ssize_t>(positions.size());
+        py::array_t<uint64_t> pieces({ count, py::ssize_t(2), py::ssize_t(6) });
+        py::array_t<uint64_t> occupancy({ count, py::ssize_t(3) });
+        py::array_t<int32_t> side(count), castling(count), enpassant(count);
+        py::array_t<bool> inCheck(count);
+        uint64_t* piecesOut = pieces.mutable_data();
+        uint64_t* occupancyOut = occupancy.mutable_data();
+        int32_t* sideOut = side.mutable_data();
+        int32_t* castlingOut = castling.mutable_data();
+        int32_t* enpassantOut = enpassant.mutable_data();
+        bool* checkOut = inCheck.mutable_data();
+        {
+            py::gil_scoped_release release;
+            ThreadPool::global()->parallelFor(positions.size(), BATCH_GRAIN, [&](size_t begin, size_t end) {
+                Board board;
+                for (size_t i = begin; i < end; i++) {
+                    positions.load(board, i);
+                    State state = board.getState();
+                    std::copy(&state.pieces[0][0], &state.pieces[0][0] + 12, piecesOut + i * 12);
+                    std::copy(state.occupancy, state.occupancy + 3, occupancyOut + i * 3);
+                    sideOut[i] = state.side;
+                    castlingOut[i] = state.castling;
+                    enpassantOut[i] = state.enpassant;
+                    checkOut[i] = state.in_check;
+                }
+            });
+        }
+        positions.raise();
+
+        py::dict d;
+        d["pieces"] = pieces;
+        d["occupancy"] = occupancy;
+        d["side"] = side;
+        d["castling"] = castling;
+        d["enpassant"] = enpassant;
+        d["in_check"] = inCheck;
+        return d;},
+        py::arg("fens"),
+        "State of every position (FEN strings or packed records) as arrays with a leading position axis: pieces, occupancy, side, castling, enpassant, in_check");
+
+    m.def("tensor_planes", &tensorPlanes, py::arg("attacks") = false,
+        "Planes per position written by the encoders");
+    m.def("encode_boards", [](const std::vector<const Board*>& boards, py::array out, bool attacks) {
+        TensorOut buffer = tensorBuffer(out, static_cast<py::ssize_t>(boards.size()), attacks, true);
+        py::gil_scoped_release release;
+        ThreadPool::global()->parallelFor(boards.size(), BATCH_GRAIN, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                encodeInto(buffer, i, *boards[i], attacks);
+        });},
+        py::arg("boards"), py::arg("out").noconvert(), py::arg("attacks") = false,
+        "Write the input planes of every board into out, a preallocated (N, C, 8, 8) float32 or uint8 array");
+    m.def("encode_fens", [](py::object fens, py::array out, bool attacks) {
+        BatchPositions positions(fens);
+        encodePositions(positions, out, attacks);},
+        py::arg("fens"), py::arg("out").noconvert(), py::arg("attacks") = false,
+        "encode_boards for FEN strings or an (N, 32) uint8 array of packed records");
+
+    m.def("move_to_uci", &moveToString, py::arg("move"),
+        "Long algebraic notation of a move, such as 'e7e8q'");
+    m.def("moves_to_uci", [](py::array_t<uint32_t, py::array::c_style | py::array::forcecast> moves) {
+        std::vector<py::ssize_t> shape(moves.shape(), moves.shape() + moves.ndim());
+        py::array strings = stringArray(shape, UCI_MAX_LENGTH - 1);
+        const uint32_t* in = moves.data();
+        uint32_t* out = static_cast<uint32_t*>(strings.mutable_data());
+        {
+            py::gil_scoped_release release;
+            char str[UCI_MAX_LENGTH];
+            for (py::ssize_t i = 0; i < moves.size(); i++)
+                putString(out, UCI_MAX_LENGTH - 1, i, str, moveToUCI(in[i], str, sizeof(str)));
+        }
+        return strings;},
+        py::arg("moves"), "move_to_uci of every element as a numpy string array of the same shape");
+
+    m.attr("POLICY_SIZE") = POLICY_SIZE;
+    m.def("move_to_index", &moveToIndex, py::arg("move"),
+        "AlphaZero policy index (plane * 64 + source, 73 planes) of a move");
+    m.def("moves_to_indices", [](py::array_t<uint32_t, py::array::c_style | py::array::forcecast> moves) {
+        py::array_t<int32_t> indices(moves.request().shape);
+        const uint32_t* in = moves.data();
+        int32_t* out = indices.mutable_data();
+        for (py::ssize_t i = 0; i < moves.size(); i++)
+            out[i] = moveToIndex(in[i]);
+        return indices;},
+        py::arg("moves"), "move_to_index of every element, same shape");
+    m.def("batch_legal_masks", [](py::object fens, py::array out) {
+        BatchPositions positions(fens);
+        uint8_t* masks = maskBuffer(out, static_cast<py::ssize_t>(positions.size()), true);
+        {
+            py::gil_scoped_release release;
+            ThreadPool::global()->parallelFor(positions.size(), BATCH_GRAIN, [&](size_t begin, size_t end) {
+                Board board;
+                for (size_t i = begin; i < end; i++) {
+                    positions.load(board, i);
+                    policyMask(board.legalMoves(), masks + i * POLICY_SIZE);
+                }
+            });
+        }
+        positions.raise();},
+        py::arg("fens"), py::arg("out").noconvert(),
+        "Policy masks of every position (FEN strings or packed records) into out, a preallocated (N, 4672) or (N, 73, 8, 8) bool or uint8 array");
+
+    m.def("read_pgn", [](const std::string& path) {
+        std::vector<PGNGame> games;
+        std::mutex mutex;
+        PGNStats stats;
+        bool ok;
+        {
+            py::gil_scoped_release release;
+            ok = readPGN(path, [&](const PGNGame& game) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (game.index >= games.size())
+                    games.resize(std::max(game.index + 1, 2 * games.size()));
+                games[game.index] = game;
+            }, &stats);
+        }
+        if (!ok)
+            throw py::value_error("could not open " + path);
+        games.resize(stats.games);
+
+        py::ssize_t count = static_cast<py::ssize_t>(games.size());
+        py::array_t<uint32_t> moves(static_cast<py::ssize_t>(stats.moves));
+        py::array_t<int64_t> offsets(count + 1);
+        py::array_t<int8_t> results(count);
+        py::array_t<bool> complete(count);
+        py::list fens;
+        uint32_t* move = moves.mutable_data();
+        int64_t* offset = offsets.mutable_data();
+        offset[0] = 0;
+        for (py::ssize_t i = 0; i < count; i++) {
+            const PGNGame& game = games[i];
+            move = std::copy(game.moves.begin(), game.moves.end(), move);
+            offset[i + 1] = offset[i] + static_cast<int64_t>(game.moves.size());
+            results.mutable_data()[i] = game.result;
+            complete.mutable_data()[i] = game.complete;
+            fens.append(game.fen);
+        }
+
+        py::dict d;
+        d["moves"] = moves;
+        d["offsets"] = offsets;
+        d["results"] = results;
+        d["complete"] = complete;
+        d["fens"] = fens;
+        return d;},
+        py::arg("path"),
+        "Mainlines of every game of a PGN file: moves[offsets[i]:offsets[i + 1]] belong to game i, results "
+        "(1, 0, -1 from white's point of view, 2 unknown), complete flags and FEN tags ('' for the start position)");
+    m.def("pgn_to_packed", [](const std::string& pgnPath, const std::string& packedPath) {
+        PGNStats stats;
+        bool ok;
+        {
+            py::gil_scoped_release release;
+            ok = pgnToPacked(pgnPath, packedPath, &stats);
+        }
+        if (!ok)
+            throw py::value_error("could not convert " + pgnPath + " to " + packedPath);
+        py::dict d;
+        d["games"] = stats.games;
+        d["moves"] = stats.moves;
+        d["errors"] = stats.errors;
+        d["records"] = stats.records;
+        return d;},
+        py::arg("pgn_path"), py::arg("packed_path"),
+        "Write every position of the fully decoded PGN mainlines with its move and game result as packed records, "
+        "returns counts of games, moves, errors (games not fully decoded, skipped) and records");
+
+    m.def("rollout", [](const Board& board, size_t n, int maxPlies, uint64_t seed, bool weighted) {
+        RolloutStats stats;
+        {
+            py::gil_scoped_release release;
+            stats = rollout(board, n, maxPlies, seed, weighted);
+        }
+        py::dict d;
+        d["games"] = stats.games;
+        d["white_wins"] = stats.whiteWins;
+        d["black_wins"] = stats.blackWins;
+        d["draws"] = stats.draws;
+        d["unfinished"] = stats.unfinished;
+        d["plies"] = stats.plies;
+        return d;},
+        py::arg("board"), py::arg("n"), py::arg("max_plies") = 0, py::arg("seed") = 0, py::arg("weighted") = false,
+        "Play n random games from the position on the thread pool (weighted: captures and promotions 4x as likely), "
+        "at most max_plies plies each (0 = to the end); returns counts of games, white_wins, black_wins, draws, "
+        "unfinished (stopped at max_plies) and plies");
+
+    m.def("rollout_batch", [](py::object fens, size_t n, int maxPlies, uint64_t seed, bool weighted) {
+        BatchPositions positions(fens);
+        size_t count = positions.size();
+        std::vector<Board> boards(count);
+        std::vector<RolloutStats> stats(count);
+        {
+            py::gil_scoped_release release;
+            ThreadPool::global()->parallelFor(count, BATCH_GRAIN, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++)
+                    positions.load(boards[i], i);
+            });
+        }
+        positions.raise();
+        {
+            py::gil_scoped_release release;
+            rolloutBatch(boards.data(), count, n, maxPlies, seed, stats.data(), weighted);
+        }
+
+        py::ssize_t size = static_cast<py::ssize_t>(count);
+        py::array_t<uint64_t> games(size), whiteWins(size), blackWins(size), draws(size), unfinished(size), plies(size);
+        for (size_t i = 0; i < count; i++) {
+            games.mutable_data()[i] = stats[i].games;
+            whiteWins.mutable_data()[i] = stats[i].whiteWins;
+            blackWins.mutable_data()[i] = stats[i].blackWins;
+            draws.mutable_data()[i] = stats[i].draws;
+            unfinished.mutable_data()[i] = stats[i].unfinished;
+            plies.mutable_data()[i] = stats[i].plies;
+        }
+        py::dict d;
+        d["games"] = games;
+        d["white_wins"] = whiteWins;
+        d["black_wins"] = blackWins;
+        d["draws"] = draws;
+        d["unfinished"] = unfinished;
+        d["plies"] = plies;
+        return d;},
+        py::arg("fens"), py::arg("n"), py::arg("max_plies") = 0, py::arg("seed") = 0, py::arg("weighted") = false,
+        "rollout() from every position (FEN strings or packed records), counts as arrays with a leading position axis");
+
+    m.def("self_play", [](const std::string& path, size_t games, int threads, int depth, uint64_t nodes, size_t hash,
+        const std::string& openings, int randomPlies, uint64_t seed, int maxPlies, int resignScore, int resignPlies,
+        int drawScore, int drawPlies, int drawMinPly, bool tablebases, py::object policy) {
+        SelfPlayConfig config;
+        config.games = games;
+        config.threads = threads;
+        config.depth = depth;
+        config.nodes = nodes;
+        config.hash = hash;
+        config.openings = openings;
+        config.randomPlies = randomPlies;
+        config.seed = seed;
+        config.maxPlies = maxPlies;
+        config.resignScore = resignScore;
+        config.resignPlies = resignPlies;
+        config.drawScore = drawScore;
+        config.drawPlies = drawPlies;
+        config.drawMinPly = drawMinPly;
+        config.tablebases = tablebases;
+
+        // the policy sees a copy, so it may play on it
+        SelfPlayPolicy callback;
+        if (!policy.is_none())
+            callback = [&policy](Board& board, int& score) -> Move {
+                py::gil_scoped_acquire acquire;
+                py::object out = policy(Board(board, false));
+                score = 0;
+                if (!py::isinstance<py::tuple>(out))
+                    return out.cast<Move>();
+                py::tuple pair = out.cast<py::tuple>();
+                if (pair.size() != 2)
+                    throw py::value_error("policy must return a move or (move, score)");
+                score = pair[1].cast<int>();
+                return pair[0].cast<Move>();
+            };
+
+        SelfPlayStats stats;
+        bool ok;
+        {
+            py::gil_scoped_release release;
+            ok = selfPlay(config, path, &stats, callback);
+        }
+        if (!ok)
+            throw py::value_error("could not write " + path + (openings.empty() ? "" : " or read openings from " + openings));
+        py::dict d;
+        d["games"] = stats.games;
+        d["records"] = stats.records;
+        d["white_wins"] = stats.whiteWins;
+        d["black_wins"] = stats.blackWins;
+        d["draws"] = stats.draws;
+        d["adjudicated"] = stats.adjudicated;
+        d["errors"] = stats.errors;
+        return d;},
+        py::arg("path"), py::arg("games"), py::arg("threads") = 0, py::arg("depth") = 0, py::arg("nodes") = 0,
+        py::arg("hash") = 16, py::arg("openings") = "", py::arg("random_plies") = 8, py::arg("seed") = 0,
+        py::arg("max_plies") = 400, py::arg("resign_score") = 1500, py::arg("resign_plies") = 6,
+        py::arg("draw_score") = 10, py::arg("draw_plies") = 12, py::arg("draw_min_ply") = 80,
+        py::arg("tablebases") = true, py::arg("policy") = py::none(),
+        "Play games on worker threads with a fixed search per move (depth and / or nodes, 5000 nodes when neither "
+        "is given), or policy(board) -> move or (move, score), and write every position after the opening as packed records with its score and the game "
+        "result. Openings are random lines of an EPD file followed by random_plies random moves; games are "
+        "adjudicated by length, resign and draw scores and tablebases. Returns counts of games, records, "
+        "white_wins, black_wins, draws, adjudicated and errors (games dropped for an illegal policy move)");
+
+    py::enum_<GameStatus>(m, "GameStatus")
+        .value("ONGOING", ONGOING)
+        .value("CHECKMATE", CHECKMATE)
+        .value("STALEMATE", STALEMATE)
+        .value("FIFTY_MOVES", FIFTY_MOVES)
+        .value("REPETITION", REPETITION)
+        .value("INSUFFICIENT_MATERIAL", INSUFFICIENT_MATERIAL)
+        .export_values();
+
+    py::class_<BoardBatch>(m, "BoardBatch")
+        .def(py::init([](size_t count, const std::string& fen) {
+            Board board;
+            parseOrRaise(board, fen);
+            return std::make_unique<BoardBatch>(count, fen);}),
+            py::arg("count"), py::arg("fen") = START_FEN,
+            "count games, all starting from fen")
+        .def("__len__", &BoardBatch::size)
+        .def("__getitem__", [](const BoardBatch& self, size_t index) {
+            if (index >= self.size())
+                throw py::index_error("board index out of range");
+            return self.board(index);},
+            py::arg("index"), "Copy of one board")
+        .def("reset", [](BoardBatch& self, const std::vector<size_t>& indices, const std::vector<std::string>& fens) {
+            if (fens.size() != 1 && fens.size() != indices.size())
+                throw py::value_error("reset needs one FEN or one per index");
+            std::vector<bool> seen(self.size());
+            for (size_t index : indices) {
+                if (index >= self.size())
+                    throw py::index_error("board index " + std::to_string(index) + " out of range");
+                if (seen[index])
+                    throw py::value_error("board index " + std::to_string(index) + " given twice");
+                seen[index] = true;
+            }
+            Board board;
+            for (const std::string& fen : fens)
+                parseOrRaise(board, fen);
+            py::gil_scoped_release release;
+            self.reset(indices, fens);},
+            py::arg("indices"), py::arg("fens"),
+            "Start new games on the given boards from one FEN each, or from a single FEN for all")
+        .def("step", [](BoardBatch& self, py::array_t<uint32_t, py::array::c_style | py::array::forcecast> moves) {
+            if (moves.ndim() != 1 || static_cast<size_t>(moves.shape(0)) != self.size())
+                throw py::value_error("step needs one move per board");
+            py::array_t<bool> played(static_cast<py::ssize_t>(self.size()));
+            const Move* in = moves.data();
+            bool* out = played.mutable_data();
+            {
+                py::gil_scoped_release release;
+                self.step(in, out);
+            }
+            return played;},
+            py::arg("moves"),
+            "Play moves[i] on board i (0 to skip), returns which boards moved; illegal moves and finished games are skipped")
+        .def("legal_move_masks", [](const BoardBatch& self) {
+            py::ssize_t count = static_cast<py::ssize_t>(self.size());
+            py::array_t<bool> masks({ count, py::ssize_t(64), py::ssize_t(64) });
+            bool* out = masks.mutable_data();
+            {
+                py::gil_scoped_release release;
+                self.legalMoveMasks(out);
+            }
+            return masks;},
+            "(N, 64, 64) bool array, masks[i, from, to] is set for every legal move of board i")
+        .def("legal_moves", [](const BoardBatch& self) {
+            size_t count = self.size();
+            py::array_t<int64_t> offsets(count + 1);
+            int64_t* offset = offsets.mutable_data();
+            offset[0] = 0;
+            for (size_t i = 0; i < count; i++)
+                offset[i + 1] = offset[i] + self.legalMoves(i).size();
+
+            py::array_t<uint32_t> moves(offset[count]);
+            uint32_t* out = moves.mutable_data();
+            for (size_t i = 0; i < count; i++)
+                out = std::copy(self.legalMoves(i).moves, self.legalMoves(i).moves + self.legalMoves(i).size(), out);
+
+            py::dict d;
+            d["moves"] = moves;
+            d["offsets"] = offsets;
+            return d;},
+            "Legal moves of every board: moves[offsets[i]:offsets[i + 1]] belong to board i")
+        .def("encode", [](const BoardBatch& self, py::array out, bool attacks) {
+            TensorOut buffer = tensorBuffer(out, static_cast<py::ssize_t>(self.size()), attacks, true);
+            py::gil_scoped_release release;
+            ThreadPool::global()->parallelFor(self.size(), BATCH_GRAIN, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++)
+                    encodeInto(buffer, i, self.board(i), attacks);
+            });},
+            py::arg("out").noconvert(), py::arg("attacks") = false,
+            "Write the input planes of every board into out, a preallocated (N, C, 8, 8) float32 or uint8 array")
+        .def("legal_mask", [](const BoardBatch& self, py::array out) {
+            uint8_t* masks = maskBuffer(out, static_cast<py::ssize_t>(self.size()), true);
+            py::gil_scoped_release release;
+            ThreadPool::global()->parallelFor(self.size(), BATCH_GRAIN, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++)
+                    policyMask(self.legalMoves(i), masks + i * POLICY_SIZE);
+            });},
+            py::arg("out").noconvert(),
+            "Policy masks of every board into out, a preallocated (N, 4672) or (N, 73, 8, 8) bool or uint8 array")
+        .def("moves_from_indices", [](const BoardBatch& self, py::array_t<int32_t, py::array::c_style | py::array::forcecast> indices) {
+            if (indices.ndim() != 1 || static_cast<size_t>(indices.shape(0)) != self.size())
+                throw py::value_error("moves_from_indices needs one index per board");
+            py::array_t<uint32_t> moves(static_cast<py::ssize_t>(self.size()));
+            const int32_t* in = indices.data();
+            uint32_t* out = moves.mutable_data();
+            for (size_t i = 0; i < self.size(); i++)
+                out[i] = moveFromIndex(self.legalMoves(i), in[i]);
+            return moves;},
+            py::arg("indices"),
+            "Legal move of every board for its policy index, 0 where the index is not legal; ready for step()")
+        .def_property_readonly("status", [](const BoardBatch& self) {
+            py::array_t<uint8_t> status(static_cast<py::ssize_t>(self.size()));
+            for (size_t i = 0; i < self.size(); i++)
+                status.mutable_data()[i] = self.status(i);
+            return status;},
+            "GameStatus code of every board")
+        .def_property_readonly("terminal", [](const BoardBatch& self) {
+            py::array_t<bool> terminal(static_cast<py::ssize_t>(self.size()));
+            for (size_t i = 0; i < self.size(); i++)
+                terminal.mutable_data()[i] = self.terminal(i);
+            return terminal;},
+            "Boards whose game is over")
+        .def_property_readonly("draw", [](const BoardBatch& self) {
+            py::array_t<bool> draw(static_cast<py::ssize_t>(self.size()));
+            for (size_t i = 0; i < self.size(); i++)
+                draw.mutable_data()[i] = self.terminal(i) && self.status(i) != CHECKMATE;
+            return draw;},
+            "Boards whose game ended in a draw")
+        .def_property_readonly("result", [](const BoardBatch& self) {
+            py::array_t<int8_t> result(static_cast<py::ssize_t>(self.size()));
+            for (size_t i = 0; i < self.size(); i++)
+                result.mutable_data()[i] = static_cast<int8_t>(self.result(i));
+            return result;},
+            "1 white won, -1 black won, 0 for draws and running games");
+
+    py::class_<PackedWriter>(m, "PackedWriter")
+        .def(py::init([](const std::string& path, bool append) {
+            auto writer = std::make_unique<PackedWriter>();
+            if (!writer->open(path, append))
+                throw py::value_error("could not open " + path);
+            return writer;}),
+            py::arg("path"), py::arg("append") = false,
+            "Write 32-byte packed position records to path")
+        .def("write", [](PackedWriter& self, const Board& board, int score, Move move, int result) {
+            if (!self.isOpen())
+                throw py::value_error("write to a closed PackedWriter");
+            if (!self.write(board, score, move, result))
+                throw py::value_error("write failed");},
+            py::arg("board"), py::arg("score") = 0, py::arg("move") = 0, py::arg("result") = 0,
+            "Append a record: score in centipawns, the move played (0 for none) and the result (1, 0, -1), all from the side to move's point of view")
+        .def("close", [](PackedWriter& self) {
+            if (!self.close())
+                throw py::value_error("write failed");},
+            "Flush and close the file")
+        .def("__len__", &PackedWriter::count, "Records written")
+        .def("__enter__", [](PackedWriter& self) -> PackedWriter& { return self; })
+        .def("__exit__", [](PackedWriter& self, py::args) { self.close(); });
+
+    py::class_<PackedReader>(m, "PackedDataset")
+        .def(py::init([](const std::string& path) {
+            auto reader = std::make_unique<PackedReader>();
+            if (!reader->open(path))
+                throw py::value_error("not a packed position file: " + path);
+            return reader;}),
+            py::arg("path"),
+            "Random access to a file of packed records through a read-only memory mapping")
+        .def("__len__", &PackedReader::size)
+        .def("__getitem__", [](const PackedReader& self, int64_t index) {
+            int64_t size = static_cast<int64_t>(self.size());
+            if (index < 0)
+                index += size;
+            if (index < 0 || index >= size)
+                throw py::index_error("record index out of range");
+            Board board;
+            FENError error = self.board(static_cast<size_t>(index), board);
+            if (error != FEN_OK)
+                throw py::value_error(std::string("invalid packed position: ") + fenErrorString(error));
+            return board;},
+            py::arg("index"), "Board of one record")
+        .def("records", &gatherRecords, py::arg("indices"),
+            "Raw records as an (N, 32) uint8 array, accepted by the batch_* functions and encode_fens")
+        .def("batch", [](const PackedReader& self, py::array_t<int64_t, py::array::c_style | py::array::forcecast> indices, py::object out, bool attacks) {
+            py::array_t<uint8_t> records = gatherRecords(self, indices);
+            const PackedPosition* record = reinterpret_cast<const PackedPosition*>(records.data());
+            BatchPositions positions(records);
+            py::ssize_t count = static_cast<py::ssize_t>(positions.size());
+            py::array planes = out.is_none()
+                ? py::array(py::array_t<float>({ count, static_cast<py::ssize_t>(tensorPlanes(attacks)), py::ssize_t(8), py::ssize_t(8) }))
+                : out.cast<py::array>();
+            TensorOut buffer = tensorBuffer(planes, count, attacks, true);
+
+            py::array_t<int16_t> scores(count);
+            py::array_t<int8_t> results(count);
+            py::array_t<uint32_t> moves(count);
+            int16_t* score = scores.mutable_data();
+            int8_t* result = results.mutable_data();
+            uint32_t* move = moves.mutable_data();
+            {
+                py::gil_scoped_release release;
+                ThreadPool::global()->parallelFor(positions.size(), BATCH_GRAIN, [&](size_t begin, size_t end) {
+                    Board board;
+                    for (size_t i = begin; i < end; i++) {
+                        positions.load(board, i);
+                        encodeInto(buffer, i, board, attacks);
+                        score[i] = record[i].score;
+                        result[i] = record[i].result;
+                        move[i] = unpackMove(board, record[i].move);
+                    }
+                });
+            }
+            positions.raise();
+
+            py::dict d;
+            d["planes"] = planes;
+            d["score"] = scores;
+            d["result"] = results;
+            d["move"] = moves;
+            return d;},
+            py::arg("indices"), py::arg("out") = py::none(), py::arg("attacks") = false,
+            "Decode records into input planes (into out, or a new float32 array), score, result and the move as an engine move (0 for none)");
+
+    py::class_<Search>(m, "Search")
+        .def(py::init([](int threads, size_t hash) {
+            auto search = std::make_unique<Search>();
+            search->setHash(hash);
+            search->setThreads(threads);
+            return search;}),
+            py::arg("threads") = 1, py::arg("hash") = 16)
+        .def("set_threads", &Search::setThreads, py::arg("count"))
+        .def("set_hash", &Search::setHash, py::arg("megabytes"))
+        .def("clear", &Search::clear, "Forget the transposition table and move ordering history")
+        .def("stats", [](const Search& self) {
+            py::dict d = statsToDict(self.stats());
+            py::list threads;
+            for (const SearchStats& stats : self.threadStats())
+                threads.append(statsToDict(stats));
+            d["threads"] = threads;
+            d["enabled"] = STATS_ENABLED;
+            return d;},
+            "Counters of the last search summed over threads (per thread under 'threads'), zero unless built with CHESS_STATS")
+        .def("analyse", [](Search& self, const Board& board, int multipv, int depth, uint64_t nodes, int64_t movetime) {
+            SearchLimits limits = analysisLimits(multipv, depth, nodes, movetime);
+            std::vector<std::vector<PVLine>> results(1);
+            {
+                py::gil_scoped_release release;
+                results[0] = self.go(board, limits).lines;
+            }
+            return linesToArrays(results, limits.multiPV, false);},
+            py::arg("board"), py::arg("multipv") = 1, py::arg("depth") = 0, py::arg("nodes") = 0, py::arg("movetime") = 0,
+            "Best lines of the position, best first: dict of moves, scores, depths, pv_lengths and 0-padded pvs arrays")
+        .def("analyse_batch", [](Search& self, const std::vector<std::string>& fens, int multipv, int depth, uint64_t nodes, int64_t movetime) {
+            SearchLimits limits = analysisLimits(multipv, depth, nodes, movetime);
+            std::vector<Board> boards(fens.size());
+            for (size_t i = 0; i < fens.size(); i++)
+                parseOrRaise(boards[i], fens[i]);
+            std::vector<std::vector<PVLine>> results(fens.size());
+            {
+                py::gil_scoped_release release;
+                for (size_t i = 0; i < fens.size(); i++)
+                    results[i] = self.go(boards[i], limits).lines;
+            }
+            return linesToArrays(results, limits.multiPV, true);},
+            py::arg("fens"), py::arg("multipv") = 1, py::arg("depth") = 0, py::arg("nodes") = 0, py::arg("movetime") = 0,
+            "analyse() for every position with the limits applied per position, arrays gain a leading position axis");
+
+    py::class_<MCTS>(m, "MCTS")
+        .def(py::init([](float cpuct, int batchSize, float virtualLoss, float fpuReduction,
+            float dirichletAlpha, float dirichletEpsilon, uint64_t seed) {
+            MCTSConfig config;
+            config.cpuct = cpuct;
+            config.batchSize = batchSize;
+            config.virtualLoss = virtualLoss;
+            config.fpuReduction = fpuReduction;
+            config.dirichletAlpha = dirichletAlpha;
+            config.dirichletEpsilon = dirichletEpsilon;
+            config.seed = seed;
+            return std::make_unique<MCTS>(config);}),
+            py::arg("cpuct") = 1.5f, py::arg("batch_size") = 16, py::arg("virtual_loss") = 1.0f,
+            py::arg("fpu_reduction") = 0.25f, py::arg("dirichlet_alpha") = 0.3f,
+            py::arg("dirichlet_epsilon") = 0.0f, py::arg("seed") = 0)
+        .def("set_root", &MCTS::setRoot, py::arg("board"), "Start a new tree at the position")
+        .def("search", [](MCTS& self, int simulations, py::object evaluator, bool attacks) {
+            if (evaluator.is_none()) {
+                py::gil_scoped_release release;
+                self.search(simulations, MCTS::nativeEvaluate);
+                return;
+            }
+
+            py::ssize_t planes = tensorPlanes(attacks);
+            auto callback = [&](const std::vector<Board*>& leaves, float* policy, float* value) {
+                py::gil_scoped_acquire acquire;
+                py::ssize_t count = static_cast<py::ssize_t>(leaves.size());
+                py::array_t<float> input({ count, planes, py::ssize_t(8), py::ssize_t(8) });
+                for (py::ssize_t i = 0; i < count; i++)
+                    encodeBoard(*leaves[i], input.mutable_data() + i * planes * 64, attacks);
+
+                py::sequence out = evaluator(input).cast<py::sequence>();
+                if (out.size() != 2)
+                    throw py::value_error("evaluator must return (policy, value)");
+                auto p = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(out[0]);
+                auto v = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(out[1]);
+                if (!p || !v || p.size() != count * POLICY_SIZE || v.size() != count)
+                    throw py::value_error("evaluator must return policy (B, 4672) and value (B,) arrays");
+                std::copy(p.data(), p.data() + p.size(), policy);
+                std::copy(v.data(), v.data() + v.size(), value);
+            };
+            py::gil_scoped_release release;
+            self.search(simulations, callback);},
+            py::arg("simulations"), py::arg("evaluator") = py::none(), py::arg("attacks") = false,
+            "Add simulations to the tree. evaluator(planes) gets a (B, C, 8, 8) float32 batch and returns "
+            "(policy logits (B, 4672), value (B,) for the side to move); None uses the engine evaluation")
+        .def("best_move", &MCTS::bestMove, "Most visited root move, 0 before any search")
+        .def("root_children", [](const MCTS& self) {
+            std::vector<MCTSChild> children = self.rootChildren();
+            py::ssize_t count = static_cast<py::ssize_t>(children.size());
+            py::array_t<uint32_t> moves(count);
+            py::array_t<float> priors(count), q(count);
+            py::array_t<int32_t> visits(count);
+            for (py::ssize_t i = 0; i < count; i++) {
+                moves.mutable_data()[i] = children[i].move;
+                priors.mutable_data()[i] = children[i].prior;
+                visits.mutable_data()[i] = children[i].visits;
+                q.mutable_data()[i] = children[i].q;
+            }
+            py::dict d;
+            d["moves"] = moves;
+            d["priors"] = priors;
+            d["visits"] = visits;
+            d["q"] = q;
+            return d;},
+            "Root moves with their priors, visits and mean values for the side to move")
+        .def("visit_policy", [](const MCTS& self) {
+            py::array_t<float> policy(POLICY_SIZE);
+            self.visitPolicy(policy.mutable_data());
+            return policy;},
+            "Root visit shares as a (4672,) float32 policy target")
+        .def_property_readonly("root_value", &MCTS::rootValue, "Mean value for the side to move at the root")
+        .def_property_readonly("root_visits", &MCTS::rootVisits)
+        .def("__len__", &MCTS::size, "Nodes in the tree");
+
     py::class_<State>(m, "State")
         .def_readonly("side", &State::side)
         .def_readonly("castling", &State::castling)
@@ -33,15 +1003,206 @@ PYBIND11_MODULE(chess_engine, m) {
     py::class_<Board>(m, "Board")
         .def(py::init<>())
         .def("get_state", &Board::getState)
-        .def("parse_fen", &Board::parseFEN, py::arg("fen"),
-            "Parse a FEN string and set the board state accordingly")
+        .def("parse_fen", [](Board& self, std::string_view fen) {
+            parseOrRaise(self, fen);},
+            py::arg("fen"),
+            "Parse a FEN string and set the board state accordingly, ValueError (board unchanged) if it is invalid")
+        .def("parse_epd", [](Board& self, std::string_view epd) {
+            std::vector<EPDOperation> operations;
+            FENError error = self.parseEPD(epd, operations);
+            if (error != FEN_OK)
+                throw py::value_error(std::string("invalid EPD: ") + fenErrorString(error));
+            py::dict d;
+            for (const EPDOperation& op : operations)
+                d[py::str(std::string(op.opcode))] = std::string(op.operand);
+            return d;},
+            py::arg("epd"),
+            "Parse an EPD line, returns its operations as {opcode: operand}")
+        .def("parse_san", [](Board& self, std::string_view san) -> py::object {
+            Move move = self.parseSAN(san);
+            return move ? py::cast(move) : py::none();},
+            py::arg("san"),
+            "Legal move of a SAN string such as 'Nbd7', 'exd8=Q+' or 'O-O-O', None if it names none or is ambiguous")
+        .def("to_fen", [](const Board& self) { return self.toFEN(); },
+            "FEN of the position")
         .def("legal_moves", [](Board& self) {
             const MoveList moves = self.legalMoves();
             return py::array_t<uint32_t>(moves.size(), moves.moves);})
+        .def("move_to_san", [](Board& self, Move move) {
+            if (!isLegalMove(self, move))
+                throw py::value_error("not a legal move: " + moveToString(move));
+            return self.moveToSAN(move);},
+            py::arg("move"), "SAN of a legal move, such as 'Nbd7', 'exd8=Q+' or 'O-O-O'")
+        .def("moves_to_san", [](Board& self, py::array_t<uint32_t, py::array::c_style | py::array::forcecast> moves, bool line) {
+            if (moves.ndim() != 1)
+                throw py::value_error("moves must be one-dimensional");
+            py::array strings = stringArray({ moves.shape(0) }, SAN_MAX_LENGTH - 1);
+            const uint32_t* in = moves.data();
+            uint32_t* out = static_cast<uint32_t*>(strings.mutable_data());
+            py::ssize_t illegal = -1;
+            {
+                py::gil_scoped_release release;
+                // a line is played on a copy, the board itself stays put
+                Board copy(self, false);
+                Board& board = line ? copy : self;
+                char str[SAN_MAX_LENGTH];
+                for (py::ssize_t i = 0; i < moves.size(); i++) {
+                    Move move = in[i];
+                    if (!isLegalMove(board, move)) {
+                        illegal = i;
+                        break;
+                    }
+                    putString(out, SAN_MAX_LENGTH - 1, i, str, board.moveToSAN(move, str, sizeof(str)));
+                    if (line)
+                        board.makeMove(move, ALL_MOVES);
+                }
+            }
+            if (illegal >= 0)
+                throw py::value_error("not a legal move at index " + std::to_string(illegal) + ": " + moveToString(in[illegal]));
+            return strings;},
+            py::arg("moves"), py::arg("line") = false,
+            "SAN of every move as a numpy string array: each a legal move of this position, or with line=True "
+            "a sequence played from it (the board is left unchanged)")
         .def("make_move",
             [](Board& self, Move move) {
                 return self.makeMove(move, MoveMode::ALL_MOVES);
             },
-            py::arg("move"));
+            py::arg("move"))
+        .def("parse_uci", [](Board& self, std::string_view move) -> py::object {
+            Move legal = self.parseMove(move);
+            return legal ? py::cast(legal) : py::none();},
+            py::arg("move"), "Legal move of a long algebraic string such as 'e7e8q', None if it names none")
+        .def("apply_uci", [](Board& self, py::object moves, bool push) {
+            // a "e2e4 e7e5 ..." string or a sequence of move strings
+            std::string text;
+            std::vector<std::string> list;
+            std::vector<std::string_view> tokens;
+            if (py::isinstance<py::str>(moves)) {
+                text = moves.cast<std::string>();
+                for (size_t pos = 0; pos < text.size();) {
+                    size_t end = text.find_first_of(" \t\r\n", pos);
+                    end = end == std::string::npos ? text.size() : end;
+                    if (end > pos)
+                        tokens.emplace_back(text.data() + pos, end - pos);
+                    pos = end + 1;
+                }
+            }
+            else {
+                list = moves.cast<std::vector<std::string>>();
+                tokens.assign(list.begin(), list.end());
+            }
+
+            size_t played = 0;
+            {
+                py::gil_scoped_release release;
+                BoardState start;
+                self.copyState(start);
+                for (; played < tokens.size(); played++) {
+                    Move move = self.parseMove(tokens[played]);
+                    if (!move || !(push ? self.push(move) : self.makeMove(move, ALL_MOVES)))
+                        break;
+                }
+                // an illegal move leaves the board where it started
+                if (played < tokens.size()) {
+                    if (push) {
+                        for (size_t i = 0; i < played; i++)
+                            self.pop();
+                    }
+                    else {
+                        self.restoreState(start);
+                    }
+                }
+            }
+            if (played < tokens.size())
+                throw py::value_error("illegal move " + std::string(tokens[played]) + " at index " + std::to_string(played));},
+            py::arg("moves"), py::arg("push") = false,
+            "Play a sequence of long algebraic moves ('e2e4 e7e5 ...' or a list), with push() when push=True; "
+            "ValueError (board unchanged) at the first illegal one")
+        .def("push", &Board::push, py::arg("move"),
+            "make_move that can be taken back with pop(), False (and no change) if the move is illegal")
+        .def("pop", [](Board& self) {
+            if (!self.undoDepth())
+                throw py::index_error("pop from an empty move stack");
+            return self.pop();},
+            "Take back the last pushed move and return it")
+        .def("undo_depth", &Board::undoDepth, "Number of moves pop() can take back")
+        .def("copy", [](const Board& self, bool stack) {
+            return Board(self, stack);},
+            py::arg("stack") = true,
+            "Independent copy of the position and its repetition history, with the move stack unless stack=False")
+        .def("__copy__", [](const Board& self) { return Board(self); })
+        .def("__deepcopy__", [](const Board& self, py::dict) { return Board(self); }, py::arg("memo"))
+        .def("to_bytes", [](const Board& self) { return py::bytes(self.serialize()); },
+            "Compact binary image of the position (no move stack), also used for pickling")
+        .def("from_bytes", [](Board& self, const std::string& data) {
+            if (!self.deserialize(data))
+                throw py::value_error("not a serialized board");},
+            py::arg("data"), "Restore a position written by to_bytes")
+        .def("to_packed", [](const Board& self, int score, Move move, int result) {
+            PackedPosition packed = packPosition(self, score, move, result);
+            return py::bytes(reinterpret_cast<const char*>(&packed), sizeof(packed));},
+            py::arg("score") = 0, py::arg("move") = 0, py::arg("result") = 0,
+            "32-byte packed record of the position, as PackedWriter.write stores it")
+        .def("from_packed", [](Board& self, const std::string& data) {
+            PackedPosition packed;
+            if (data.size() != sizeof(packed))
+                throw py::value_error("packed records are 32 bytes");
+            memcpy(&packed, data.data(), sizeof(packed));
+            FENError error = unpackPosition(packed, self);
+            if (error != FEN_OK)
+                throw py::value_error(std::string("invalid packed position: ") + fenErrorString(error));},
+            py::arg("data"), "Set the position of a packed record, ValueError (board unchanged) if it is invalid")
+        .def(py::pickle(
+            [](const Board& self) { return py::bytes(self.serialize()); },
+            [](const py::bytes& data) {
+                Board board;
+                if (!board.deserialize(data))
+                    throw py::value_error("not a serialized board");
+                return board;}))
+        .def("encode", [](const Board& self, py::array out, bool attacks) {
+            encodeInto(tensorBuffer(out, 1, attacks, false), 0, self, attacks);},
+            py::arg("out").noconvert(), py::arg("attacks") = false,
+            "Write the input planes into out, a preallocated (C, 8, 8) float32 or uint8 array")
+        .def("legal_mask", [](Board& self, py::array out) {
+            policyMask(self.legalMoves(), maskBuffer(out, 1, false));},
+            py::arg("out").noconvert(),
+            "Policy mask into out, a preallocated (4672,) or (73, 8, 8) bool or uint8 array")
+        .def("move_from_index", [](Board& self, int index) -> py::object {
+            Move move = moveFromIndex(self.legalMoves(), index);
+            return move ? py::cast(move) : py::none();},
+            py::arg("index"),
+            "Legal move with that policy index, None if there is none")
+        .def("is_draw", &Board::isDraw,
+            "Draw by threefold repetition or the fifty-move rule, counted from the last parse_fen")
+        .def("status", &Board::status,
+            "GameStatus of the position: checkmate and stalemate, then draws by the fifty-move rule, threefold "
+            "repetition and insufficient material; stops at the first legal move instead of generating them all")
+        .def("evaluate", &Board::evaluate,
+            "Static evaluation in centipawns from the side to move's point of view")
+        .def("evaluate_nnue", &Board::evaluateNNUE,
+            "NNUE evaluation in centipawns from the side to move's point of view, falls back to evaluate() without a network")
+        .def("probe_wdl", [](Board& self) -> py::object {
+            bool ok;
+            int wdl = syzygyProbeWDL(self, ok);
+            return ok ? py::cast(wdl) : py::none();},
+            "Tablebase result for the side to move (-2 loss .. 2 win), None if not available")
+        .def("probe_dtz", [](Board& self) -> py::object {
+            bool ok;
+            int dtz = syzygyProbeDTZ(self, ok);
+            return ok ? py::cast(dtz) : py::none();},
+            "Plies to the next capture or pawn move with optimal play, None if not available")
+        .def("polyglot_key", &polyglotKey,
+            "Position key used by Polyglot opening books")
+        .def("book_moves", [](Board& self) {
+            py::list entries;
+            for (const BookEntry& entry : bookEntries(self))
+                entries.append(py::make_tuple(entry.move, entry.weight));
+            return entries;},
+            "Legal book moves of the position as (move, weight) pairs")
+        .def("book_move", [](Board& self, bool best) -> py::object {
+            Move move = bookMove(self, best);
+            return move ? py::cast(move) : py::none();},
+            py::arg("best") = false,
+            "Book move picked in proportion to its weight (or the heaviest with best=True), None if out of book");
 }
 
@@ -0,0 +1,69 @@
+#include "board_batch.h"
+
+#include <algorithm>
+
+#include "thread_pool.h"
+
+// boards per pool task
+constexpr size_t STEP_GRAIN = 64;
+
+BoardBatch::BoardBatch(size_t count, const std::string& fen)
+    : legal(count), statuses(count, ONGOING) {
+    Board board;
+    board.parseFEN(fen);
+    boards.assign(count, board);
+
+    ThreadPool::global()->parallelFor(count, STEP_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            update(i);
+    });
+}
+
+void BoardBatch::reset(const std::vector<size_t>& indices, const std::vector<std::string>& fens) {
+    ThreadPool::global()->parallelFor(indices.size(), STEP_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            boards[indices[i]].parseFEN(fens.size() == 1 ? fens[0] : fens[i]);
+            update(indices[i]);
+        }
+    });
+}
+
+void BoardBatch::step(const Move* moves, bool* played) {
+    ThreadPool::global()->parallelFor(boards.size(), STEP_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const MoveList& moveList = legal[i];
+            played[i] = moves[i] && statuses[i] == ONGOING
+                && std::find(moveList.moves, moveList.moves + moveList.size(), moves[i]) != moveList.moves + moveList.size()
+                && boards[i].makeMove(moves[i], ALL_MOVES);
+            if (played[i])
+                update(i);
+        }
+    });
+}
+
+void BoardBatch::legalMoveMasks(bool* out) const {
+    ThreadPool::global()->parallelFor(boards.size(), STEP_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            bool* mask = out + i * 64 * 64;
+            std::fill_n(mask, 64 * 64, false);
+            for (size_t k = 0; k < legal[i].size(); k++) {
+                MoveStore m(legal[i][k]);
+                mask[m.getSource() * 64 + m.getTarget()] = true;
+            }
+        }
+    });
+}
+
+int BoardBatch::result(size_t index) const {
+    if (statuses[index] != CHECKMATE)
+        return 0;
+    return boards[index].getSide() == White ? -1 : 1;
+}
+
+void BoardBatch::update(size_t index) {
+    statuses[index] = boards[index].status();
+    if (statuses[index] == CHECKMATE || statuses[index] == STALEMATE)
+        legal[index].clear();
+    else
+        legal[index] = boards[index].legalMoves();
+}
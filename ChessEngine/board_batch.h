@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chess.h"
+
+// N independent games stepped together for reinforcement learning: every call works
+// on the whole batch across the shared thread pool, and the legal moves and game
+// status of each board are kept up to date after every reset and step
+
+class BoardBatch {
+public:
+    explicit BoardBatch(size_t count, const std::string& fen = START_FEN);
+
+    size_t size() const { return boards.size(); }
+    const Board& board(size_t index) const { return boards[index]; }
+    const MoveList& legalMoves(size_t index) const { return legal[index]; }
+
+    // fens holds one FEN per index, or a single FEN for all of them; indices must be
+    // distinct and in range
+    void reset(const std::vector<size_t>& indices, const std::vector<std::string>& fens);
+
+    // plays moves[i] on board i; 0 leaves a board as it is, and so does a move that
+    // is not legal there or a board whose game is over. played[i] tells which moved
+    void step(const Move* moves, bool* played);
+
+    // out[i][from][to] is set for every legal move of board i, promotions share the
+    // entry of their from / to squares
+    void legalMoveMasks(bool* out) const;
+
+    GameStatus status(size_t index) const { return statuses[index]; }
+    bool terminal(size_t index) const { return statuses[index] != ONGOING; }
+    // 1 white won, -1 black won, 0 for draws and games still running
+    int result(size_t index) const;
+
+private:
+    std::vector<Board> boards;
+    std::vector<MoveList> legal;
+    std::vector<GameStatus> statuses;
+
+    void update(size_t index);
+};
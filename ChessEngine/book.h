@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chess.h"
+
+// Polyglot opening books (.bin): 16-byte big-endian entries sorted by a position key
+// built from Polyglot's own Zobrist numbers, so the engine's hashKey can't be used.
+// The file is memory-mapped once and shared read-only by every thread
+
+struct BookEntry {
+    Move move;
+    int weight;
+};
+
+// returns false if the file is missing or not a whole number of entries; an empty
+// string unloads the book. The old mapping is released, so no lookup may be running
+bool bookInit(const std::string& path);
+
+bool bookLoaded();
+
+// Polyglot key of the position (castling rights, side to move and an en passant
+// file only when a pawn can actually capture)
+uint64_t polyglotKey(const Board& board);
+
+// legal book moves of the position with their weights, in file order
+std::vector<BookEntry> bookEntries(Board& board);
+
+// a book move picked at random in proportion to its weight, or the heaviest one
+// with bestOnly; 0 when the position is not in the book
+Move bookMove(Board& board, bool bestOnly = false);
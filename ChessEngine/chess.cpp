@@ -1,17 +1,23 @@
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
 #include <iomanip>
 #include <string>
 #include <sstream>
 #include <array>
-#include <windows.h>
+#include <chrono>
+#include <mutex>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 #include "chess.h"
+#include "evaluate.h"
 #include "logger.h"
 
 // FEN dedug positions
 constexpr auto empty_board = "8/8/8/8/8/8/8/8 w - - ";
-constexpr auto start_position = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 constexpr auto tricky_position = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
 constexpr auto killer_position = "rnbqkb1r/pp1p1pPp/8/2p1pP2/1P1P4/3P3P/P1P1P3/RNBQKBNR w KQkq e6 0 1";
 constexpr auto cmk_position = "r2q1rk1/ppp2ppp/2n1bn2/2b1p3/3pP3/3P1NPP/PPP1NPB1/R1BQ1RK1 b - - 0 9";
@@ -30,7 +36,7 @@ Logger logger(Logger::Level::INFO);
 
 const char* ColorNames[3] = { "White", "Black", "All" };
 const char* PieceTypeNames[6] = { "Pawn", "Knight", "Bishop", "Rook", "Queen", "King" };
-const char* PromotedPieces[6] = { " ", "k", "b", "r", "q", " " };
+const char* PromotedPieces[6] = { " ", "n", "b", "r", "q", " " };
 const char* SquareNames[64] = {
         "a1", "b1", "c1", "d1", "e1", "f1", "g1", "h1",
         "a2", "b2", "c2", "d2", "e2", "f2", "g2", "h2",
@@ -92,18 +98,12 @@ const int castling_rights[64] = {
 
 // preserve board state
 #define saveState()                                                         \
-    Bitboard prev_pieceBitboards[2][6], prev_occupancyBitboards[3];         \
-    int prev_side, prev_enpassant, prev_castling;                           \
-    bool prev_in_check;                                                     \
-    memcpy(prev_pieceBitboards, pieceBitboards, 96);                        \
-    memcpy(prev_occupancyBitboards, occupancyBitboards, 24);                \
-    prev_side = side, prev_enpassant = enpassant, prev_castling = castling; \
+    BoardState prev_state;                                                  \
+    copyState(prev_state);                                                  \
 
 // restore board state
 #define takeBack()                                                          \
-    memcpy(pieceBitboards, prev_pieceBitboards, 96);                        \
-    memcpy(occupancyBitboards, prev_occupancyBitboards, 24);                \
-    side = prev_side, enpassant = prev_enpassant, castling = prev_castling; \
+    restoreState(prev_state);                                               \
 
 
 // pseudo random number state
@@ -159,24 +159,23 @@ bool getBit(Bitboard bitboard, Square square) {
 }
 
 int countBits(Bitboard bitboard) {
-
-    int count = 0;
-
-    while (bitboard) {
-        count++;
-        bitboard &= bitboard - 1;
-    }
-    return count;
+#if defined(_MSC_VER)
+    return static_cast<int>(__popcnt64(bitboard));
+#else
+    return __builtin_popcountll(bitboard);
+#endif
 }
 
 int getLSBIndex(Bitboard bitboard) {
-
-    if (bitboard) {
-        return countBits((bitboard & (~bitboard + 1)) - 1);
-    }
-    else {
+    if (!bitboard)
         return -1;
-    }
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bitboard);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(bitboard);
+#endif
 }
 
 Bitboard setOccupancy(int index, int numMaskBits, Bitboard attackMask) {
@@ -217,6 +216,12 @@ static const int relevantBitcountRook[64] = {
     12, 11, 11, 11, 11, 11, 11, 12
 };
 
+// zobrist keys
+static Bitboard pieceKeys[2][6][64];
+static Bitboard enpassantKeys[64];
+static Bitboard castlingKeys[16];
+static Bitboard sideKey;
+
 // helper masks
 static const Bitboard notFile_A = 18374403900871474942ULL;
 static const Bitboard notFile_AB = 18229723555195321596ULL;
@@ -224,13 +229,13 @@ static const Bitboard notFile_H = 9187201950435737471ULL;
 static const Bitboard notFile_HG = 4557430888798830399ULL;
 
 // pawnAttacks[color (white, black)][square]
-static Bitboard pawnAttacks[2][64];
+Bitboard pawnAttacks[2][64];
 
 // knightAttacks[square]
-static Bitboard knightAttacks[64];
+Bitboard knightAttacks[64];
 
 // kingAttacks[square]
-static Bitboard kingAttacks[64];
+Bitboard kingAttacks[64];
 
 //// bishop attack masks
 static Bitboard bishop_masks[64];
@@ -524,7 +529,7 @@ Bitboard dynamicRookAttacks(Square square, Bitboard blocker) {
 }
 
 // get bishop attacks
-inline Bitboard getBishopAttacks(int square, Bitboard occupancy) {
+Bitboard getBishopAttacks(int square, Bitboard occupancy) {
     // get bishop attacks assuming current board occupancy
     occupancy &= bishop_masks[square];
     occupancy *= bishop_magic_numbers[square];
@@ -535,7 +540,7 @@ inline Bitboard getBishopAttacks(int square, Bitboard occupancy) {
 }
 
 // get rook attacks
-inline Bitboard getRookAttacks(int square, Bitboard occupancy) {
+Bitboard getRookAttacks(int square, Bitboard occupancy) {
     // get rook attacks assuming current board occupancy
     occupancy &= rook_masks[square];
     occupancy *= rook_magic_numbers[square];
@@ -545,7 +550,7 @@ inline Bitboard getRookAttacks(int square, Bitboard occupancy) {
     return rook_attacks[square][occupancy];
 }
 
-inline Bitboard getQueenAttacks(int square, Bitboard occupancy) {
+Bitboard getQueenAttacks(int square, Bitboard occupancy) {
 
     Bitboard diagonalAttacks = getBishopAttacks(square, occupancy);
     Bitboard straightAttacks = getRookAttacks(square, occupancy);
@@ -553,6 +558,17 @@ inline Bitboard getQueenAttacks(int square, Bitboard occupancy) {
     return diagonalAttacks | straightAttacks;
 }
 
+// squares a knight, slider or king on square attacks
+static Bitboard pieceAttacks(int piece, int square, Bitboard occupancy) {
+    switch (piece) {
+    case Knight: return knightAttacks[square];
+    case Bishop: return getBishopAttacks(square, occupancy);
+    case Rook:   return getRookAttacks(square, occupancy);
+    case Queen:  return getQueenAttacks(square, occupancy);
+    default:     return kingAttacks[square];
+    }
+}
+
 MoveStore::MoveStore(Move move)
     : source(move& FROM_SQ_MASK),
     target((move& TO_SQ_MASK) >> 6),
@@ -630,7 +646,8 @@ Move& MoveList::operator[](size_t i) noexcept {
 // get time in milliseconds
 uint64_t get_time_ms()
 {
-    return GetTickCount64();
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
 }
 
 uint64_t Board::perft_driver(int depth)
@@ -670,7 +687,7 @@ void Board::perft_test(int depth)
     uint64_t total_nodes = 0;
 
     // init start time
-    long start = get_time_ms();
+    uint64_t start = get_time_ms();
 
     // loop over generated moves
     for (size_t i = 0; i < moveList.size(); i++) {
@@ -704,70 +721,341 @@ void Board::perft_test(int depth)
     // print summary
     printf("\n    Depth: %d\n", depth);
     printf("    Nodes: %llu\n", (unsigned long long)total_nodes);
-    printf("     Time: %lld ms\n\n", get_time_ms() - start);
+    printf("     Time: %llu ms\n\n", (unsigned long long)(get_time_ms() - start));
+}
+
+size_t moveToUCI(Move move, char* out, size_t size) {
+    MoveStore m(move);
+    size_t length = m.getPromoted() ? 5 : 4;
+    if (size <= length)
+        return 0;
+    memcpy(out, SquareNames[m.getSource()], 2);
+    memcpy(out + 2, SquareNames[m.getTarget()], 2);
+    if (m.getPromoted())
+        out[4] = PromotedPieces[m.getPromoted()][0];
+    out[length] = '\0';
+    return length;
 }
 
-// parse user/GUI move string input (e.g. "e7e8q")
-Move Board::parseMove(const std::string& move_string) {
+// long algebraic move string (e.g. "e7e8q")
+std::string moveToString(Move move) {
+    char str[UCI_MAX_LENGTH];
+    return std::string(str, moveToUCI(move, str, sizeof(str)));
+}
 
-    MoveList moveList = generateMoves();
-    // parse source square
-    int source_square = (move_string[0] - 'a') + (move_string[1] - '1') * 8;
+// parse user/GUI move string input (e.g. "e7e8q"), the squares go straight to findMove
+Move Board::parseMove(std::string_view move) {
+    if (move.size() != 4 && move.size() != 5)
+        return 0;
+    for (int i = 0; i < 4; i += 2) {
+        if (move[i] < 'a' || move[i] > 'h' || move[i + 1] < '1' || move[i + 1] > '8')
+            return 0;
+    }
+    int source = (move[0] - 'a') + (move[1] - '1') * 8;
+    int target = (move[2] - 'a') + (move[3] - '1') * 8;
+
+    int promoted = 0;
+    if (move.size() == 5) {
+        switch (move[4]) {
+        case 'n': promoted = Knight; break;
+        case 'b': promoted = Bishop; break;
+        case 'r': promoted = Rook; break;
+        case 'q': promoted = Queen; break;
+        default: return 0;
+        }
+    }
+    return findMove(source, target, promoted);
+}
 
-    // parse target square
-    int target_square = (move_string[2] - 'a') + (move_string[3] - '1') * 8;
+// standard algebraic notation ("Nbd7", "exd8=Q+", "O-O-O"); the source squares come from
+// the attack tables and go through findMove, so no move list is generated
+Move Board::parseSAN(std::string_view san) {
+    // check, mate and annotation marks
+    while (!san.empty() && strchr("+#!?", san.back()))
+        san.remove_suffix(1);
+
+    int king = side == White ? e1 : e8;
+    if (san == "O-O" || san == "0-0")
+        return findMove(king, king + 2, 0);
+    if (san == "O-O-O" || san == "0-0-0")
+        return findMove(king, king - 2, 0);
+
+    // promotion, "=Q" or just "Q"
+    int promoted = 0;
+    if (!san.empty() && strchr("NBRQ", san.back())) {
+        promoted = symbolToPiece[static_cast<uint8_t>(san.back())].type;
+        san.remove_suffix(1);
+        if (!san.empty() && san.back() == '=')
+            san.remove_suffix(1);
+    }
+    if (san.size() < 2)
+        return 0;
+    char file = san[san.size() - 2], rank = san[san.size() - 1];
+    if (file < 'a' || file > 'h' || rank < '1' || rank > '8')
+        return 0;
+    int target = (rank - '1') * 8 + (file - 'a');
+    san.remove_suffix(2);
+
+    // piece letter, then source file / rank disambiguation and the capture mark
+    int piece = Pawn, sourceFile = -1, sourceRank = -1;
+    size_t i = 0;
+    if (!san.empty() && strchr("NBRQK", san[0]))
+        piece = symbolToPiece[static_cast<uint8_t>(san[i++])].type;
+    for (; i < san.size(); i++) {
+        if (san[i] >= 'a' && san[i] <= 'h')
+            sourceFile = san[i] - 'a';
+        else if (san[i] >= '1' && san[i] <= '8')
+            sourceRank = san[i] - '1';
+        else if (san[i] != 'x')
+            return 0;
+    }
 
-    // loop over generated moves
-    for (size_t i = 0; i < moveList.size(); i++) {
+    // pieces that reach the target (attacks are symmetric), pawns from behind it
+    Bitboard sources;
+    if (piece == Pawn) {
+        int forward = side == White ? 8 : -8;
+        sources = pawnAttacks[!side][target];
+        if (target - forward >= 0 && target - forward < 64)
+            sources |= 1ULL << (target - forward);
+        if (target - 2 * forward >= 0 && target - 2 * forward < 64)
+            sources |= 1ULL << (target - 2 * forward);
+        // pawn moves without a source file are pushes
+        if (sourceFile < 0)
+            sourceFile = target % 8;
+    }
+    else {
+        sources = pieceAttacks(piece, target, getOccupancy(All));
+    }
+    sources &= getPieces(side, piece);
 
-        Move move = moveList[i];
-        MoveStore m(move);
+    Move found = 0;
+    for (; sources; sources &= sources - 1) {
+        int source = getLSBIndex(sources);
+        if ((sourceFile >= 0 && source % 8 != sourceFile) || (sourceRank >= 0 && source / 8 != sourceRank))
+            continue;
+        Move move = findMove(source, target, promoted);
+        if (!move)
+            continue;
+        // more than one legal move fits
+        if (found)
+            return 0;
+        found = move;
+    }
+    return found;
+}
 
-        // make sure source & target squares are available within the generated move
-        if (source_square == m.getSource() && target_square == m.getTarget()) {
-            // init promoted piece
-            int promoted_piece = m.getPromoted();
-
-            // promoted piece is available
-            if (promoted_piece) {
-                // promoted to queen
-                if (promoted_piece == Queen && move_string[4] == 'q')
-                    // return legal move
-                    return move;
-
-                // promoted to rook
-                else if (promoted_piece == Rook && move_string[4] == 'r')
-                    // return legal move
-                    return move;
-
-                // promoted to bishop
-                else if (promoted_piece == Bishop && move_string[4] == 'b')
-                    // return legal move
-                    return move;
-
-                // promoted to knight
-                else if (promoted_piece == Knight && move_string[4] == 'n')
-                    // return legal move
-                    return move;
-
-                // continue the loop on possible wrong promotions (e.g. "e7e8f")
-                continue;
+// the move is built from the squares: the piece on source must reach target by its own
+// rules (castling as in kingMoves), then it is played and taken back to test legality
+Move Board::findMove(int source, int target, int promoted) {
+    if (source < 0 || source > 63 || target < 0 || target > 63)
+        return 0;
+    Bitboard to = 1ULL << target;
+    if (!getBit(colorBitboards[side], static_cast<Square>(source)) || (colorBitboards[side] & to))
+        return 0;
+
+    int piece = pieceOn(source);
+    bool capture = (colorBitboards[!side] & to) != 0;
+    bool doublePush = false, enpassantMove = false, castle = false;
+
+    if (piece == Pawn) {
+        int forward = side == White ? 8 : -8;
+        bool lastRank = target / 8 == (side == White ? 7 : 0);
+        if (lastRank != (promoted >= Knight && promoted <= Queen))
+            return 0;
+
+        if (pawnAttacks[side][source] & to) {
+            if (!capture) {
+                if (target != enpassant)
+                    return 0;
+                capture = enpassantMove = true;
             }
-            // return legal move
-            return move;
+        }
+        else if (capture) {
+            return 0;
+        }
+        else if (target == source + 2 * forward) {
+            if (source / 8 != (side == White ? 1 : 6) || getBit(getOccupancy(All), static_cast<Square>(source + forward)))
+                return 0;
+            doublePush = true;
+        }
+        else if (target != source + forward) {
+            return 0;
         }
     }
-    return 0;
+    else {
+        if (promoted)
+            return 0;
+        if (!(pieceAttacks(piece, source, getOccupancy(All)) & to)) {
+            // castling, the king may not start on or pass an attacked square
+            int king = side == White ? e1 : e8;
+            Color enemy = static_cast<Color>(!side);
+            if (piece != King || source != king || capture)
+                return 0;
+            if (target == king + 2) {
+                if (!(castling & (side == White ? wk : bk))
+                    || (getOccupancy(All) & (3ULL << (king + 1)))
+                    || isSquareAttacked(static_cast<Square>(king), enemy) || isSquareAttacked(static_cast<Square>(king + 1), enemy))
+                    return 0;
+            }
+            else if (target == king - 2) {
+                if (!(castling & (side == White ? wq : bq))
+                    || (getOccupancy(All) & (7ULL << (king - 3)))
+                    || isSquareAttacked(static_cast<Square>(king), enemy) || isSquareAttacked(static_cast<Square>(king - 1), enemy))
+                    return 0;
+            }
+            else {
+                return 0;
+            }
+            castle = true;
+        }
+    }
+
+    Move move = encodeMove(source, target, side, piece, promoted, capture, doublePush, enpassantMove, castle);
+    saveState();
+    bool legal = makeMove(move, ALL_MOVES);
+    takeBack();
+    return legal ? move : 0;
 }
 
+// check from the attack tables with the move applied to copies of the bitboards; only
+// checking moves are played, to look for a reply that makes the suffix '+' rather than '#'
+size_t Board::moveToSAN(Move move, char* out, size_t size) {
+    MoveStore m(move);
+    int source = m.getSource(), target = m.getTarget(), piece = m.getPiece(), promoted = m.getPromoted();
+    char str[SAN_MAX_LENGTH];
+    size_t length = 0;
+
+    if (m.isCastling()) {
+        memcpy(str, target % 8 == 6 ? "O-O" : "O-O-O", target % 8 == 6 ? 3 : 5);
+        length = target % 8 == 6 ? 3 : 5;
+    }
+    else {
+        if (piece != Pawn) {
+            str[length++] = PieceSymbols[White][piece][0];
+
+            // other pieces of the kind that can legally go to the target
+            Bitboard others = pieceAttacks(piece, target, getOccupancy(All)) & getPieces(side, piece) & ~(1ULL << source);
+            bool sameFile = false, sameRank = false, ambiguous = false;
+            for (; others; others &= others - 1) {
+                int other = getLSBIndex(others);
+                if (!findMove(other, target, 0))
+                    continue;
+                ambiguous = true;
+                sameFile |= other % 8 == source % 8;
+                sameRank |= other / 8 == source / 8;
+            }
+            if (ambiguous && (!sameFile || sameRank))
+                str[length++] = static_cast<char>('a' + source % 8);
+            if (sameFile)
+                str[length++] = static_cast<char>('1' + source / 8);
+        }
+        else if (m.isCapture()) {
+            str[length++] = static_cast<char>('a' + source % 8);
+        }
+        if (m.isCapture())
+            str[length++] = 'x';
+        memcpy(str + length, SquareNames[target], 2);
+        length += 2;
+        if (promoted) {
+            str[length++] = '=';
+            str[length++] = PieceSymbols[White][promoted][0];
+        }
+    }
+
+    // our pieces and the occupancy once the move is made
+    Bitboard from = 1ULL << source, to = 1ULL << target;
+    Bitboard pieces[6];
+    for (int type = Pawn; type <= King; type++)
+        pieces[type] = getPieces(side, type);
+    Bitboard occupancy = (getOccupancy(All) & ~from) | to;
+    pieces[piece] &= ~from;
+    pieces[promoted ? promoted : piece] |= to;
+    if (m.isEnPassant())
+        occupancy &= ~(1ULL << (target + (side == White ? -8 : 8)));
+    if (m.isCastling()) {
+        int rookFrom = target % 8 == 6 ? target + 1 : target - 2;
+        int rookTo = target % 8 == 6 ? target - 1 : target + 1;
+        occupancy = (occupancy & ~(1ULL << rookFrom)) | 1ULL << rookTo;
+        pieces[Rook] = (pieces[Rook] & ~(1ULL << rookFrom)) | 1ULL << rookTo;
+    }
+
+    int king = getLSBIndex(getPieces(!side, King));
+    bool check = (pawnAttacks[!side][king] & pieces[Pawn]) || (knightAttacks[king] & pieces[Knight])
+        || (getBishopAttacks(king, occupancy) & (pieces[Bishop] | pieces[Queen]))
+        || (getRookAttacks(king, occupancy) & (pieces[Rook] | pieces[Queen]));
+    if (check) {
+        saveState();
+        bool mate = makeMove(move, ALL_MOVES) && !hasLegalMove();
+        takeBack();
+        str[length++] = mate ? '#' : '+';
+    }
+
+    if (size <= length)
+        return 0;
+    memcpy(out, str, length);
+    out[length] = '\0';
+    return length;
+}
+
+std::string Board::moveToSAN(Move move) {
+    char str[SAN_MAX_LENGTH];
+    return std::string(str, moveToSAN(move, str, sizeof(str)));
+}
+
+// attacked by a color's pieces (colorPieces of the types) with a given occupancy
+static bool attackedWith(const Bitboard types[6], Bitboard colorPieces, int color, int square, Bitboard occupancy) {
+    return ((pawnAttacks[!color][square] & types[Pawn])
+        | (knightAttacks[square] & types[Knight])
+        | (kingAttacks[square] & types[King])
+        | (getBishopAttacks(square, occupancy) & (types[Bishop] | types[Queen]))
+        | (getRookAttacks(square, occupancy) & (types[Rook] | types[Queen]))) & colorPieces;
+}
+
+// king steps first, with the king lifted off the board so sliders see through it; then,
+// out of check, any piece off the king's lines (so not pinned) with a square to go to.
+// Pins, evasions, castling and en passant are left to the generated moves
+bool Board::hasLegalMove() {
+    int us = side, them = side ^ 1;
+    Bitboard own = colorBitboards[us];
+    Bitboard occupancy = getOccupancy(All);
+    Bitboard king = getPieces(us, King);
+    int kingSquare = getLSBIndex(king);
+
+    for (Bitboard targets = kingAttacks[kingSquare] & ~own; targets; targets &= targets - 1)
+        if (!attackedWith(typeBitboards, colorBitboards[them], them, getLSBIndex(targets), occupancy ^ king))
+            return true;
+
+    if (!attackedWith(typeBitboards, colorBitboards[them], them, kingSquare, occupancy)) {
+        Bitboard unpinned = own & ~king & ~getQueenAttacks(kingSquare, occupancy);
+        for (Bitboard pawns = getPieces(us, Pawn) & unpinned; pawns; pawns &= pawns - 1) {
+            int square = getLSBIndex(pawns);
+            int push = us == White ? square + 8 : square - 8;
+            if (!getBit(occupancy, static_cast<Square>(push)) || (pawnAttacks[us][square] & colorBitboards[them]))
+                return true;
+        }
+        for (int piece = Knight; piece <= Queen; piece++)
+            for (Bitboard pieces = getPieces(us, piece) & unpinned; pieces; pieces &= pieces - 1)
+                if (pieceAttacks(piece, getLSBIndex(pieces), occupancy) & ~own)
+                    return true;
+    }
+
+    MoveList moveList;
+    generateMoves(moveList, GEN_EVASIONS);
+    for (size_t i = 0; i < moveList.size(); i++) {
+        saveState();
+        bool legal = makeMove(moveList[i], ALL_MOVES);
+        takeBack();
+        if (legal)
+            return true;
+    }
+    return false;
+}
 
 MoveList Board::legalMoves() {
 
-    MoveList possible_moves = generateMoves();
-    //std::cout << "Possible moves: " << possible_moves.count << std::endl;
-    //for (size_t i = 0; i < possible_moves.count; i++) {
-    //    std::cout << possible_moves[i] << std::endl;
-    //}
+    // in check only the evasions, in the same order as the full list
+    MoveList possible_moves;
+    generateMoves(possible_moves, GEN_EVASIONS);
     MoveList legal_moves;
     // loop over generated moves
     for (size_t i = 0; i < possible_moves.count; i++) {
@@ -780,24 +1068,65 @@ MoveList Board::legalMoves() {
             legal_moves.add(move);
         }
     }
-    //std::cout << "Legal moves: " << legal_moves.count << std::endl;
-    //for (size_t i = 0; i < legal_moves.count; i++) {
-    //    std::cout << legal_moves[i] << std::endl;
-    //}
     return legal_moves;
 }
 
+// attack tables and zobrist keys are shared by every board; boards may be created
+// on several threads at once, so they are built exactly once
+static std::once_flag sharedTablesInit;
+
 Board::Board()
 {
     // initialize empty board
     initTables();
-    // initialize attack tables for leaper pieces (Pawn, Knight, King)
-    initLeaperPieces();
-    // initialize attack tables for sliding pieces (Bishop, Rook, Queen)
-    initSliderPieces();
+    std::call_once(sharedTablesInit, [this] {
+        // initialize attack tables for leaper pieces (Pawn, Knight, King)
+        initLeaperPieces();
+        // initialize attack tables for sliding pieces (Bishop, Rook, Queen)
+        initSliderPieces();
+        // initialize zobrist hashing keys
+        initZobristKeys();
+    });
     side = White;
     enpassant = no_sq;
     castling = 0;
+    nnuePly = 0;
+    halfmoveClock = 0;
+    gamePly = 0;
+    moveOffset = 0;
+    resetScores();
+    resetKeys();
+    keyHistory.assign(512, 0);
+    keyHistory[0] = hashKey;
+}
+
+Board::Board(const Board& other, bool undo)
+{
+    copyFrom(other, undo);
+}
+
+Board& Board::operator=(const Board& other) {
+    if (this != &other)
+        copyFrom(other, true);
+    return *this;
+}
+
+// only the live part of the key history is copied, and no accumulators: entries up to
+// the copied ply are marked stale and the next evaluation refreshes them
+void Board::copyFrom(const Board& other, bool undo) {
+    BoardState state;
+    other.copyState(state);
+    restoreState(state);
+    moveOffset = other.moveOffset;
+
+    keyHistory.assign(other.keyHistory.begin(), other.keyHistory.begin() + gamePly + 1);
+    if (undo)
+        undoStack = other.undoStack;
+    else
+        undoStack.clear();
+
+    for (int ply = 0; ply <= nnuePly && ply < static_cast<int>(nnueStack.size()); ply++)
+        nnueStack[ply].computed[White] = nnueStack[ply].computed[Black] = false;
 }
 
 State Board::getState() const {
@@ -806,33 +1135,163 @@ State Board::getState() const {
     // copy piece bitboards
     for (int c = 0; c < 2; ++c)
         for (int p = 0; p < 6; ++p)
-            state.pieces[c][p] = pieceBitboards[c][p];
+            state.pieces[c][p] = getPieces(c, p);
     
     // copy occupancy bitboards
     for (int i = 0; i < 3; ++i)
-        state.occupancy[i] = occupancyBitboards[i];
+        state.occupancy[i] = getOccupancy(i);
 
     state.side = side;
     state.castling = castling;
     state.enpassant = enpassant;
     state.in_check = isSquareAttacked(
-        static_cast<Square>(getLSBIndex(pieceBitboards[side][King])), 
+        static_cast<Square>(getLSBIndex(getPieces(side, King))), 
         static_cast<Color>(!side)
     );
 
     return state;
 }
 
+// the position is the BoardState the board derives from, two cache lines to copy
+void Board::copyState(BoardState& state) const {
+    state = *this;
+}
+
+void Board::restoreState(const BoardState& state) {
+    static_cast<BoardState&>(*this) = state;
+}
+
+int Board::getSide() const {
+    return side;
+}
+
+int Board::getCastling() const {
+    return castling;
+}
+
+// en passant target square or no_sq
+int Board::getEnpassant() const {
+    return enpassant;
+}
+
+Bitboard Board::getPieces(int color, int piece) const {
+    return typeBitboards[piece] & colorBitboards[color];
+}
+
+// White, Black or All
+Bitboard Board::getOccupancy(int color) const {
+    return color == All ? colorBitboards[White] | colorBitboards[Black] : colorBitboards[color];
+}
+
+// piece type on a square or -1 when empty
+int Board::pieceOn(int square) const {
+    int entry = (mailbox[square >> 1] >> ((square & 1) * 4)) & 0xf;
+    return entry == NO_PIECE ? -1 : entry % 6;
+}
+
+bool Board::inCheck() const {
+    return isSquareAttacked(static_cast<Square>(getLSBIndex(getPieces(side, King))), static_cast<Color>(!side));
+}
+
+// pass the move to the opponent, used by null move pruning (restore with restoreState)
+void Board::makeNullMove() {
+    if (enpassant != no_sq)
+        hashKey ^= enpassantKeys[enpassant];
+    enpassant = no_sq;
+    side ^= 1;
+    hashKey ^= sideKey;
+
+    // positions before a null move can't be repeated behind it
+    halfmoveClock = 0;
+    if (++gamePly == static_cast<int>(keyHistory.size()))
+        keyHistory.resize(keyHistory.size() * 2);
+    keyHistory[gamePly] = hashKey;
+}
+
+bool Board::push(Move move) {
+    undoStack.push_back({});
+    copyState(undoStack.back().state);
+    undoStack.back().move = move;
+
+    if (!makeMove(move, ALL_MOVES)) {
+        undoStack.pop_back();
+        return false;
+    }
+    return true;
+}
+
+Move Board::pop() {
+    if (undoStack.empty())
+        return 0;
+
+    restoreState(undoStack.back().state);
+    Move move = undoStack.back().move;
+    undoStack.pop_back();
+    return move;
+}
+
+size_t Board::undoDepth() const {
+    return undoStack.size();
+}
+
+// the current position occurred `times` times before, only looking back to the last
+// irreversible move; a position can only repeat with the same side to move, 4+ plies apart
+bool Board::isRepetition(int times) const {
+    int end = std::min<int>(halfmoveClock, gamePly);
+    for (int i = 4; i <= end; i += 2)
+        if (keyHistory[gamePly - i] == hashKey && --times == 0)
+            return true;
+    return false;
+}
+
+// draw by the fifty-move rule or threefold repetition, a mate on the hundredth ply still counts
+bool Board::isDraw() {
+    if (halfmoveClock >= 100)
+        return !inCheck() || hasLegalMove();
+    return isRepetition(2);
+}
+
+bool Board::insufficientMaterial() const {
+    for (int color = White; color <= Black; color++)
+        if (getPieces(color, Pawn) | getPieces(color, Rook) | getPieces(color, Queen))
+            return false;
+    return countBits(getOccupancy(All)) <= 3;
+}
+
+// a mate or stalemate on the hundredth ply beats the fifty-move rule
+GameStatus Board::status() {
+    if (!hasLegalMove())
+        return inCheck() ? CHECKMATE : STALEMATE;
+    if (halfmoveClock >= 100)
+        return FIFTY_MOVES;
+    if (isRepetition(2))
+        return REPETITION;
+    if (insufficientMaterial())
+        return INSUFFICIENT_MATERIAL;
+    return ONGOING;
+}
+
+int Board::getHalfmoveClock() const {
+    return halfmoveClock;
+}
+
+int Board::getFullmoveNumber() const {
+    return (moveOffset + gamePly) / 2 + 1;
+}
+
+uint64_t Board::getHashKey() const {
+    return hashKey;
+}
+
+uint64_t Board::getPawnKey() const {
+    return pawnKey;
+}
+
 // initialization methods //
 void Board::initTables() {
-    for (int piece = Pawn; piece <= King; piece++) {
-        pieceBitboards[White][piece] = 0ULL;
-        pieceBitboards[Black][piece] = 0ULL;
-    }
-    // initialize occupancy bitboards to 0
-    for (int color = White; color <= All; color++) {
-        occupancyBitboards[color] = 0ULL;
-    }
+    memset(typeBitboards, 0, sizeof(typeBitboards));
+    memset(colorBitboards, 0, sizeof(colorBitboards));
+    memset(mailbox, NO_PIECE * 0x11, sizeof(mailbox));
 }
 
 void Board::initLeaperPieces() {
@@ -909,371 +1368,757 @@ void Board::initSliderPieces() {
     }
 }
 
-void Board::parseFEN(const std::string& fen) {
+void Board::initZobristKeys() {
+    if (sideKey)
+        return;
 
-    side = White;
-    enpassant = no_sq;
-    castling = 0;
+    for (int color = White; color <= Black; color++)
+        for (int piece = Pawn; piece <= King; piece++)
+            for (int square = a1; square <= h8; square++)
+                pieceKeys[color][piece][square] = get_random_U64_number();
 
-    memset(pieceBitboards, 0ULL, sizeof(pieceBitboards));
-    memset(occupancyBitboards, 0ULL, sizeof(occupancyBitboards));
+    for (int square = a1; square <= h8; square++)
+        enpassantKeys[square] = get_random_U64_number();
 
-    std::string boardT, sideT, castleT, enpassantT;
-    int halfmoveclock, fullmovenumber;
+    for (int rights = 0; rights < 16; rights++)
+        castlingKeys[rights] = get_random_U64_number();
 
-    std::istringstream ss(fen);
-    ss >> boardT >> sideT >> castleT >> enpassantT >> halfmoveclock >> fullmovenumber;
+    sideKey = get_random_U64_number();
+    logger.debug("init zobrist keys");
+}
 
-    // Parse board
-    int rank = 7;
-    int file = 0;
-    for (char c : boardT) {
+const char* fenErrorString(FENError error) {
+    switch (error) {
+    case FEN_OK: return "ok";
+    case FEN_BAD_PLACEMENT: return "bad piece placement";
+    case FEN_BAD_KINGS: return "each side needs exactly one king";
+    case FEN_BAD_SIDE: return "bad side to move";
+    case FEN_BAD_CASTLING: return "bad castling rights";
+    case FEN_BAD_ENPASSANT: return "bad en passant square";
+    case FEN_BAD_COUNTERS: return "bad move counters";
+    case FEN_BAD_OPERATIONS: return "bad EPD operations";
+    }
+    return "unknown error";
+}
+
+// next space separated field of text from pos on, empty at the end
+static std::string_view nextField(std::string_view text, size_t& pos) {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t'))
+        pos++;
+    size_t start = pos;
+    while (pos < text.size() && text[pos] != ' ' && text[pos] != '\t')
+        pos++;
+    return text.substr(start, pos - start);
+}
+
+static bool parseNumber(std::string_view field, int& value) {
+    if (field.empty() || field.size() > 6)
+        return false;
+    value = 0;
+    for (char c : field) {
+        if (c < '0' || c > '9')
+            return false;
+        value = value * 10 + (c - '0');
+    }
+    return true;
+}
+
+// the position fields (and counters) of text, committed to the board only when valid
+// the text fields of a FEN / EPD, setPosition checks what they describe
+FENError Board::readPosition(std::string_view text, bool counters) {
+    size_t pos = 0;
+    std::string_view placement = nextField(text, pos);
+    std::string_view sideField = nextField(text, pos);
+    std::string_view castleField = nextField(text, pos);
+    std::string_view enpassantField = nextField(text, pos);
+
+    // piece placement, rank 8 first
+    Bitboard pieces[2][6] = {};
+    int rank = 7, file = 0;
+    for (char c : placement) {
         if (c == '/') {
+            if (file != 8 || rank == 0)
+                return FEN_BAD_PLACEMENT;
             rank--;
             file = 0;
         }
-        else if (isdigit(c)) {
+        else if (c >= '1' && c <= '8') {
             file += c - '0';
+            if (file > 8)
+                return FEN_BAD_PLACEMENT;
         }
         else {
-            int square = rank * 8 + file;
-            Piece piece = symbolToPiece[c];
-            setBit(pieceBitboards[piece.color][piece.type], static_cast<Square>(square));
+            Piece piece = symbolToPiece[static_cast<uint8_t>(c)];
+            if (file > 7 || (piece.type == Pawn && c != 'P' && c != 'p'))
+                return FEN_BAD_PLACEMENT;
+            setBit(pieces[piece.color][piece.type], static_cast<Square>(rank * 8 + file));
             file++;
         }
     }
+    if (rank != 0 || file != 8)
+        return FEN_BAD_PLACEMENT;
+
+    if (sideField != "w" && sideField != "b")
+        return FEN_BAD_SIDE;
+    int newSide = sideField == "w" ? White : Black;
+
+    int newCastling = 0;
+    if (castleField != "-") {
+        if (castleField.empty() || castleField.size() > 4)
+            return FEN_BAD_CASTLING;
+        for (char c : castleField) {
+            int right = c == 'K' ? wk : c == 'Q' ? wq : c == 'k' ? bk : c == 'q' ? bq : 0;
+            if (!right || (newCastling & right))
+                return FEN_BAD_CASTLING;
+            newCastling |= right;
+        }
+    }
 
-    // Parse side to move
-    side = (sideT == "w") ? White : Black;
+    int newEnpassant = no_sq;
+    if (enpassantField != "-") {
+        if (enpassantField.size() != 2 || enpassantField[0] < 'a' || enpassantField[0] > 'h'
+            || enpassantField[1] < '1' || enpassantField[1] > '8')
+            return FEN_BAD_ENPASSANT;
+        newEnpassant = (enpassantField[1] - '1') * 8 + (enpassantField[0] - 'a');
+    }
 
-    // Parse castling rights
-    for (char c : castleT) {
-        switch (c) {
-        case 'K': castling |= wk; break;
-        case 'Q': castling |= wq; break;
-        case 'k': castling |= bk; break;
-        case 'q': castling |= bq; break;
-        case '-': break;
-        default: break;
-        }
+    // optional counters, nothing may follow them
+    int halfmove = 0, fullmove = 1;
+    if (counters) {
+        std::string_view halfmoveField = nextField(text, pos);
+        std::string_view fullmoveField = nextField(text, pos);
+        if ((!halfmoveField.empty() && !parseNumber(halfmoveField, halfmove))
+            || (!fullmoveField.empty() && !parseNumber(fullmoveField, fullmove))
+            || !nextField(text, pos).empty())
+            return FEN_BAD_COUNTERS;
     }
+    else if (!nextField(text, pos).empty()) {
+        return FEN_BAD_COUNTERS;
+    }
+
+    return setPosition(pieces, newSide, newCastling, newEnpassant, halfmove, fullmove);
+}
 
-    // Parse en passant
-    if (enpassantT != "-") {
-        int ep_file = enpassantT[0] - 'a';
-        int ep_rank = enpassantT[1] - '1';
-        enpassant = ep_rank * 8 + ep_file;
+FENError Board::setPosition(const Bitboard pieces[2][6], int newSide, int newCastling, int newEnpassant,
+    int halfmove, int fullmove) {
+    Bitboard white = 0ULL, black = 0ULL;
+    int count = 0;
+    for (int piece = Pawn; piece <= King; piece++) {
+        white |= pieces[White][piece];
+        black |= pieces[Black][piece];
+        count += countBits(pieces[White][piece]) + countBits(pieces[Black][piece]);
     }
-    else {
-        enpassant = no_sq;
+    const Bitboard backRanks = 0xff000000000000ffULL;
+    if (countBits(white | black) != count || ((pieces[White][Pawn] | pieces[Black][Pawn]) & backRanks))
+        return FEN_BAD_PLACEMENT;
+    if (countBits(pieces[White][King]) != 1 || countBits(pieces[Black][King]) != 1)
+        return FEN_BAD_KINGS;
+    if (newSide != White && newSide != Black)
+        return FEN_BAD_SIDE;
+    if (newCastling < 0 || newCastling > 15)
+        return FEN_BAD_CASTLING;
+    if (halfmove < 0)
+        return FEN_BAD_COUNTERS;
+
+    // rights only count with the king and the rook on their squares
+    if (!getBit(pieces[White][King], e1)) newCastling &= ~(wk | wq);
+    if (!getBit(pieces[White][Rook], h1)) newCastling &= ~wk;
+    if (!getBit(pieces[White][Rook], a1)) newCastling &= ~wq;
+    if (!getBit(pieces[Black][King], e8)) newCastling &= ~(bk | bq);
+    if (!getBit(pieces[Black][Rook], h8)) newCastling &= ~bk;
+    if (!getBit(pieces[Black][Rook], a8)) newCastling &= ~bq;
+
+    // the square behind a pawn of the side that just moved
+    if (newEnpassant != no_sq) {
+        if (newEnpassant < 0 || newEnpassant > h8 || newEnpassant / 8 != (newSide == White ? 5 : 2)
+            || !getBit(pieces[!newSide][Pawn], static_cast<Square>(newEnpassant + (newSide == White ? -8 : 8))))
+            return FEN_BAD_ENPASSANT;
     }
 
-    // Set occupancy boards
-    for (int color = White; color <= Black; color++) {
-        for (int piece = Pawn; piece <= King; piece++) {
-            occupancyBitboards[color] |= pieceBitboards[color][piece];
-        }
+    initTables();
+    for (int color = White; color <= Black; color++)
+        for (int piece = Pawn; piece <= King; piece++)
+            for (Bitboard bitboard = pieces[color][piece]; bitboard; bitboard &= bitboard - 1)
+                placePiece(color, piece, getLSBIndex(bitboard));
+    side = newSide, castling = newCastling, enpassant = newEnpassant;
+    halfmoveClock = std::min(halfmove, 0xffff);
+
+    resetScores();
+    resetKeys();
+
+    // the history starts over at the new position
+    gamePly = 0;
+    moveOffset = 2 * (std::max(fullmove, 1) - 1) + newSide;
+    undoStack.clear();
+    keyHistory[0] = hashKey;
+
+    // accumulators no longer match the position
+    if (!nnueStack.empty()) {
+        nnuePly = 0;
+        nnueStack[0].computed[White] = nnueStack[0].computed[Black] = false;
     }
-    occupancyBitboards[All] |= occupancyBitboards[White];
-    occupancyBitboards[All] |= occupancyBitboards[Black];
+    return FEN_OK;
 }
 
-bool Board::isSquareAttacked(Square square, Color side) const {
-
-    // std::cout << "Checking if square " << square << " is attacked by side " << (side == White ? "White" : "Black") << std::endl;
-    // check if pawn attacks - reverse thinking -- if black pawn attack hits white pawn -- then that sqaure is attacked by white pawn
-    if (pawnAttacks[!side][square] & pieceBitboards[side][Pawn]) { return true; }
+FENError Board::parseFEN(std::string_view fen) {
+    return readPosition(fen, true);
+}
 
-    // check if knight attacks
-    if (knightAttacks[square] & pieceBitboards[side][Knight]) { return true; }
+FENError Board::parseEPD(std::string_view epd, std::vector<EPDOperation>& operations) {
+    size_t pos = 0;
+    for (int field = 0; field < 4; field++)
+        nextField(epd, pos);
+
+    // opcode [operand ...]; with ';' allowed inside quotes
+    operations.clear();
+    int halfmove = -1, fullmove = -1;
+    while (true) {
+        std::string_view opcode = nextField(epd, pos);
+        if (opcode.empty())
+            break;
+        bool ended = opcode.back() == ';';
+        if (ended)
+            opcode.remove_suffix(1);
+        if (opcode.empty())
+            return FEN_BAD_OPERATIONS;
+
+        size_t start = pos;
+        bool quoted = false;
+        while (!ended && pos < epd.size()) {
+            if (epd[pos] == '"')
+                quoted = !quoted;
+            else if (epd[pos] == ';' && !quoted)
+                ended = true;
+            pos++;
+        }
+        if (!ended)
+            return FEN_BAD_OPERATIONS;
+
+        std::string_view operand = epd.substr(start, pos - start - (start < pos ? 1 : 0));
+        while (!operand.empty() && (operand.front() == ' ' || operand.front() == '\t'))
+            operand.remove_prefix(1);
+        while (!operand.empty() && (operand.back() == ' ' || operand.back() == '\t'))
+            operand.remove_suffix(1);
+        if (operand.size() >= 2 && operand.front() == '"' && operand.back() == '"'
+            && operand.find('"', 1) == operand.size() - 1)
+            operand = operand.substr(1, operand.size() - 2);
+
+        if ((opcode == "hmvc" && !parseNumber(operand, halfmove))
+            || (opcode == "fmvn" && !parseNumber(operand, fullmove)))
+            return FEN_BAD_OPERATIONS;
+        operations.push_back({ opcode, operand });
+    }
 
-    // check if king attacks
-    if (kingAttacks[square] & pieceBitboards[side][King]) { return true; }
+    size_t fieldsEnd = 0;
+    for (int field = 0; field < 4; field++)
+        nextField(epd, fieldsEnd);
+    FENError error = readPosition(epd.substr(0, fieldsEnd), false);
+    if (error != FEN_OK)
+        return error;
+
+    if (halfmove >= 0)
+        halfmoveClock = std::min(halfmove, 0xffff);
+    if (fullmove >= 0)
+        moveOffset = 2 * (std::max(fullmove, 1) - 1) + side;
+    return FEN_OK;
+}
 
-    // check if bishop attacks
-    if (getBishopAttacks(square, occupancyBitboards[All]) & pieceBitboards[side][Bishop]) { return true; }
+static char* writeNumber(char* p, int value) {
+    char digits[12];
+    int count = 0;
+    unsigned int v = static_cast<unsigned int>(std::max(value, 0));
+    do {
+        digits[count++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (count)
+        *p++ = digits[--count];
+    return p;
+}
 
-    // check if rook attacks
-    if (getRookAttacks(square, occupancyBitboards[All]) & pieceBitboards[side][Rook]) { return true; }
+size_t Board::toFEN(char* out, size_t size) const {
+    char fen[FEN_MAX_LENGTH];
+    char* p = fen;
 
-    // check if queen attacks
-    if (getQueenAttacks(square, occupancyBitboards[All]) & pieceBitboards[side][Queen]) { return true; }
+    for (int rank = 7; rank >= 0; rank--) {
+        int empty = 0;
+        for (int file = 0; file < 8; file++) {
+            int square = rank * 8 + file;
+            int piece = pieceOn(square);
+            if (piece < 0) {
+                empty++;
+                continue;
+            }
+            if (empty)
+                *p++ = static_cast<char>('0' + empty), empty = 0;
+            *p++ = PieceSymbols[getBit(colorBitboards[White], static_cast<Square>(square)) ? White : Black][piece][0];
+        }
+        if (empty)
+            *p++ = static_cast<char>('0' + empty);
+        if (rank)
+            *p++ = '/';
+    }
 
-    return false;
+    *p++ = ' ';
+    *p++ = side == White ? 'w' : 'b';
+    *p++ = ' ';
+    if (!castling)
+        *p++ = '-';
+    if (castling & wk) *p++ = 'K';
+    if (castling & wq) *p++ = 'Q';
+    if (castling & bk) *p++ = 'k';
+    if (castling & bq) *p++ = 'q';
+    *p++ = ' ';
+    if (enpassant != no_sq)
+        *p++ = SquareNames[enpassant][0], *p++ = SquareNames[enpassant][1];
+    else
+        *p++ = '-';
+    *p++ = ' ';
+    p = writeNumber(p, halfmoveClock);
+    *p++ = ' ';
+    p = writeNumber(p, getFullmoveNumber());
+
+    size_t length = p - fen;
+    if (length + 1 > size) {
+        if (size)
+            out[0] = '\0';
+        return 0;
+    }
+    memcpy(out, fen, length);
+    out[length] = '\0';
+    return length;
 }
 
-void Board::pawnMoves(Color side, MoveList& moveList) {
-    Bitboard bitboard, attacks;
-    int source_square, target_square;
+std::string Board::toFEN() const {
+    char fen[FEN_MAX_LENGTH];
+    size_t length = toFEN(fen, sizeof(fen));
+    return std::string(fen, length);
+}
 
-    int square_offset = (side == White) ? 8 : -8;
-    int start_rank_left = (side == White) ? a2 : a7;
-    int start_rank_right = (side == White) ? h2 : h7;
-    int promo_rank_left = (side == White) ? a7 : a2;
-    int promo_rank_right = (side == White) ? h7 : h2;
+// serialize layout (integers little-endian):
+//   u8 version, u64 pieces[2][6], u8 side, u8 castling, u8 enpassant (64 = none),
+//   u16 halfmove clock, u16 fullmove number, u16 key count, u64 keys[count] (oldest first)
+constexpr uint8_t SERIALIZE_VERSION = 1;
+constexpr size_t SERIALIZE_HEADER = 1 + 12 * 8 + 3 + 3 * 2;
 
-    bitboard = pieceBitboards[side][Pawn];
+static void putBytes(std::string& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++)
+        out += static_cast<char>((value >> (8 * i)) & 0xff);
+}
 
-    while (bitboard) {
+static uint64_t getBytes(const std::string& in, size_t& pos, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++)
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(in[pos++])) << (8 * i);
+    return value;
+}
 
-        source_square = getLSBIndex(bitboard);
-        target_square = source_square + square_offset;
+std::string Board::serialize() const {
+    int keys = std::min<int>(halfmoveClock, gamePly);
+
+    std::string out;
+    out.reserve(SERIALIZE_HEADER + keys * 8);
+    putBytes(out, SERIALIZE_VERSION, 1);
+    for (int color = White; color <= Black; color++)
+        for (int piece = Pawn; piece <= King; piece++)
+            putBytes(out, getPieces(color, piece), 8);
+    putBytes(out, side, 1);
+    putBytes(out, castling, 1);
+    putBytes(out, enpassant, 1);
+    putBytes(out, halfmoveClock, 2);
+    putBytes(out, std::min(getFullmoveNumber(), 0xffff), 2);
+    putBytes(out, keys, 2);
+    for (int ply = gamePly - keys; ply < gamePly; ply++)
+        putBytes(out, keyHistory[ply], 8);
+    return out;
+}
 
-        if (target_square < 0 || target_square > 63) { continue; }
+// false (board unchanged) if the data is not a valid serialize() image
+bool Board::deserialize(const std::string& data) {
+    size_t pos = 0;
+    if (data.size() < SERIALIZE_HEADER || getBytes(data, pos, 1) != SERIALIZE_VERSION)
+        return false;
+
+    Bitboard pieces[2][6];
+    for (int color = White; color <= Black; color++)
+        for (int piece = Pawn; piece <= King; piece++)
+            pieces[color][piece] = getBytes(data, pos, 8);
+    int newSide = static_cast<int>(getBytes(data, pos, 1));
+    int newCastling = static_cast<int>(getBytes(data, pos, 1));
+    int newEnpassant = static_cast<int>(getBytes(data, pos, 1));
+    int halfmove = static_cast<int>(getBytes(data, pos, 2));
+    int fullmove = static_cast<int>(getBytes(data, pos, 2));
+    int keys = static_cast<int>(getBytes(data, pos, 2));
+    if (data.size() != SERIALIZE_HEADER + static_cast<size_t>(keys) * 8
+        || setPosition(pieces, newSide, newCastling, newEnpassant, halfmove, fullmove) != FEN_OK)
+        return false;
+
+    if (keyHistory.size() <= static_cast<size_t>(keys))
+        keyHistory.resize(keys + 1);
+    for (int ply = 0; ply < keys; ply++)
+        keyHistory[ply] = getBytes(data, pos, 8);
+    gamePly = keys;
+    moveOffset -= keys;
+    keyHistory[gamePly] = hashKey;
+    return true;
+}
 
-        // generate quite pawn moves
-        if (!getBit(occupancyBitboards[All], static_cast<Square>(target_square))) {
-            // pawn promotion
-            if (source_square >= promo_rank_left && source_square <= promo_rank_right) {
-                moveList.add(encodeMove(source_square, target_square, side, Pawn, Queen, false, false, false, false));
-                moveList.add(encodeMove(source_square, target_square, side, Pawn, Rook, false, false, false, false));
-                moveList.add(encodeMove(source_square, target_square, side, Pawn, Bishop, false, false, false, false));
-                moveList.add(encodeMove(source_square, target_square, side, Pawn, Knight, false, false, false, false));
-            }
-            else {
-                // one square ahead pawn move
-                moveList.add(encodeMove(source_square, target_square, side, Pawn, 0, false, false, false, false));
-                // two squares ahead pawn move
-                if ((source_square >= start_rank_left && source_square <= start_rank_right) &&
-                    !getBit(occupancyBitboards[All], static_cast<Square>(target_square + square_offset))) {
-                    moveList.add(encodeMove(source_square, target_square + square_offset, side, Pawn, 0, false, true, false, false));
-                }
-            }
-        }
-        // get the attack moves for the selected pawn
-        attacks = pawnAttacks[side][source_square] & occupancyBitboards[!side];
-        while (attacks) {
-            target_square = getLSBIndex(attacks);
-            // pawn promotion
-            if (source_square >= promo_rank_left && source_square <= promo_rank_right) {
-                moveList.add(encodeMove(source_square, target_square, side, Pawn, Queen, true, false, false, false));
-                moveList.add(encodeMove(source_square, target_square, side, Pawn, Rook, true, false, false, false));
-                moveList.add(encodeMove(source_square, target_square, side, Pawn, Bishop, true, false, false, false));
-                moveList.add(encodeMove(source_square, target_square, side, Pawn, Knight, true, false, false, false));
-            }
-            else {
-                // one square ahead pawn move
-                moveList.add(encodeMove(source_square, target_square, side, Pawn, 0, true, false, false, false));
-            }
-            // remove attacked piece from pawn attacks
-            clearBit(attacks, static_cast<Square>(target_square));
-        }
-        // generate enpassant captures on a per piece basis so here for this single piece then next piece next iteration
-        if (enpassant != no_sq) {
-            // lookup pawn attacks and bitwise AND with enpassant square (bit)
-            Bitboard enpassant_attacks = pawnAttacks[side][source_square] & (1ULL << enpassant);
-            // make sure enpassant capture available
-            if (enpassant_attacks) {
-                // init enpassant capture target square
-                int target_enpassant = getLSBIndex(enpassant_attacks);
-                moveList.add(encodeMove(source_square, target_enpassant, side, Pawn, 0, true, false, true, false));
-            }
-        }
-        // remove pawn from current pawns on board
-        clearBit(bitboard, static_cast<Square>(source_square));
-    }
+// set the bitboards and the mailbox only
+void Board::placePiece(int color, int piece, int square) {
+    setBit(typeBitboards[piece], static_cast<Square>(square));
+    setBit(colorBitboards[color], static_cast<Square>(square));
+    int shift = (square & 1) * 4;
+    mailbox[square >> 1] = static_cast<uint8_t>((mailbox[square >> 1] & ~(0xf << shift)) | (color * 6 + piece) << shift);
 }
 
-void Board::kingMoves(Color side, MoveList& moveList) {
-    Bitboard bitboard, attacks;
-    int source_square, target_square;
+// place a piece and update the incremental evaluation terms
+void Board::addPiece(int color, int piece, int square) {
+    placePiece(color, piece, square);
+    int sign = color == White ? 1 : -1;
+    mgScore += sign * mgPieceSquare[color][piece][square];
+    egScore += sign * egPieceSquare[color][piece][square];
+    gamePhase += gamePhaseInc[piece];
+    hashKey ^= pieceKeys[color][piece][square];
+    if (piece == Pawn)
+        pawnKey ^= pieceKeys[color][piece][square];
+    markDirty(color, piece, square, 1);
+}
 
-    bitboard = pieceBitboards[side][King];
+// remove a piece and update the incremental evaluation terms
+void Board::removePiece(int color, int piece, int square) {
+    clearBit(typeBitboards[piece], static_cast<Square>(square));
+    clearBit(colorBitboards[color], static_cast<Square>(square));
+    mailbox[square >> 1] |= NO_PIECE << ((square & 1) * 4);
+    int sign = color == White ? 1 : -1;
+    mgScore -= sign * mgPieceSquare[color][piece][square];
+    egScore -= sign * egPieceSquare[color][piece][square];
+    gamePhase -= gamePhaseInc[piece];
+    hashKey ^= pieceKeys[color][piece][square];
+    if (piece == Pawn)
+        pawnKey ^= pieceKeys[color][piece][square];
+    markDirty(color, piece, square, -1);
+}
 
-    while (bitboard) {
+// open the accumulator entry for the next ply, computed lazily from its parent
+void Board::pushAccumulator() {
+    if (nnueStack.empty())
+        return;
 
-        source_square = getLSBIndex(bitboard);
-        attacks = kingAttacks[source_square] & ~occupancyBitboards[side];
+    if (nnuePly + 1 == NNUE_MAX_PLY) {
+        // out of stack (long games without takeBack), start over with full refreshes
+        for (NNUEEntry& entry : nnueStack) {
+            entry.computed[White] = entry.computed[Black] = false;
+            entry.refresh[White] = entry.refresh[Black] = true;
+        }
+        nnuePly = 0;
+    }
+    else {
+        nnuePly++;
+    }
 
-        while (attacks) {
+    NNUEEntry& entry = nnueStack[nnuePly];
+    entry.computed[White] = entry.computed[Black] = false;
+    entry.refresh[White] = entry.refresh[Black] = false;
+    entry.dirty.count = 0;
+}
 
-            target_square = getLSBIndex(attacks);
-            // quiet move
-            if (!getBit(occupancyBitboards[!side], static_cast<Square>(target_square))) {
-                moveList.add(encodeMove(source_square, target_square, side, King, 0, false, false, false, false));
-            }
-            else {
-                // captures
-                moveList.add(encodeMove(source_square, target_square, side, King, 0, true, false, false, false));
-            }
+// record a feature change for the current accumulator entry
+void Board::markDirty(int color, int piece, int square, int sign) {
+    if (nnueStack.empty())
+        return;
+
+    NNUEEntry& entry = nnueStack[nnuePly];
+    NNUEDirtyPiece& dirty = entry.dirty;
+    dirty.color[dirty.count] = color;
+    dirty.piece[dirty.count] = piece;
+    dirty.square[dirty.count] = square;
+    dirty.sign[dirty.count] = sign;
+    dirty.count++;
+
+    // every feature is relative to the own king, moving it invalidates the whole accumulator
+    if (piece == King)
+        entry.refresh[color] = true;
+}
 
-            clearBit(attacks, static_cast<Square>(target_square));
-        }
-        clearBit(bitboard, static_cast<Square>(source_square));
-    }
-    // castling moves
-    if (side == White) {
-        if (castling & wk) {
-            // make sure square between king and king's rook are empty
-            if (!getBit(occupancyBitboards[All], f1) && !getBit(occupancyBitboards[All], g1))
-            {
-                // make sure king and the f1 squares are not under attacks
-                if (!isSquareAttacked(e1, Black) && !isSquareAttacked(f1, Black)) {
-                    moveList.add(encodeMove(e1, g1, side, King, 0, false, false, false, true));
-                    //printf("e1g1  castling move\n");
-                }
-            }
-        }
-        if (castling & wq) {
-            // make sure square between king and queen's rook are empty
-            if (!getBit(occupancyBitboards[All], d1) && !getBit(occupancyBitboards[All], c1) && !getBit(occupancyBitboards[All], b1)) {
-                // make sure king and the d1 squares are not under attacks
-                if (!isSquareAttacked(e1, Black) && !isSquareAttacked(d1, Black)) {
-                    moveList.add(encodeMove(e1, c1, side, King, 0, false, false, false, true));
-                }
+// recompute the incremental evaluation terms from the piece bitboards
+void Board::resetScores() {
+    gamePhase = 0;
+    mgScore = egScore = 0;
+    for (int color = White; color <= Black; color++) {
+        int sign = color == White ? 1 : -1;
+        for (int piece = Pawn; piece <= King; piece++) {
+            Bitboard bitboard = getPieces(color, piece);
+            while (bitboard) {
+                int square = getLSBIndex(bitboard);
+                mgScore += sign * mgPieceSquare[color][piece][square];
+                egScore += sign * egPieceSquare[color][piece][square];
+                gamePhase += gamePhaseInc[piece];
+                clearBit(bitboard, static_cast<Square>(square));
             }
         }
     }
-    else {
+}
 
-        if (castling & bk) {
-            // make sure square between king and king's rook are empty
-            if (!getBit(occupancyBitboards[All], f8) && !getBit(occupancyBitboards[All], g8))
-            {
-                // make sure king and the f8 squares are not under attacks
-                if (!isSquareAttacked(e8, White) && !isSquareAttacked(f8, White)) {
-                    moveList.add(encodeMove(e8, g8, side, King, 0, false, false, false, true));
-                }
-            }
-        }
-        if (castling & bq)
-        {
-            // make sure square between king and queen's rook are empty
-            if (!getBit(occupancyBitboards[All], d8) && !getBit(occupancyBitboards[All], c8) && !getBit(occupancyBitboards[All], b8))
-            {
-                // make sure king and the d8 squares are not under attacks
-                if (!isSquareAttacked(e8, White) && !isSquareAttacked(d8, White)) {
-                    moveList.add(encodeMove(e8, c8, side, King, 0, false, false, false, true));
-                }
+// recompute the zobrist keys from scratch
+void Board::resetKeys() {
+    hashKey = 0ULL;
+    pawnKey = 0ULL;
+    for (int color = White; color <= Black; color++) {
+        for (int piece = Pawn; piece <= King; piece++) {
+            Bitboard bitboard = getPieces(color, piece);
+            while (bitboard) {
+                int square = getLSBIndex(bitboard);
+                hashKey ^= pieceKeys[color][piece][square];
+                if (piece == Pawn)
+                    pawnKey ^= pieceKeys[color][piece][square];
+                clearBit(bitboard, static_cast<Square>(square));
             }
         }
     }
+    if (enpassant != no_sq)
+        hashKey ^= enpassantKeys[enpassant];
+    hashKey ^= castlingKeys[castling];
+    if (side == Black)
+        hashKey ^= sideKey;
 }
 
-void Board::knightMoves(Color side, MoveList& moveList) {
-    Bitboard bitboard, attacks;
-    int source_square, target_square;
-
-    bitboard = pieceBitboards[side][Knight];
-
-    while (bitboard) {
+bool Board::isSquareAttacked(Square square, Color side) const {
 
-        source_square = getLSBIndex(bitboard);
-        attacks = knightAttacks[source_square] & ~occupancyBitboards[side];
+    // std::cout << "Checking if square " << square << " is attacked by side " << (side == White ? "White" : "Black") << std::endl;
+    // check if pawn attacks - reverse thinking -- if black pawn attack hits white pawn -- then that sqaure is attacked by white pawn
+    if (pawnAttacks[!side][square] & getPieces(side, Pawn)) { return true; }
 
-        while (attacks) {
+    // check if knight attacks
+    if (knightAttacks[square] & getPieces(side, Knight)) { return true; }
 
-            target_square = getLSBIndex(attacks);
-            // quiet move
-            if (!getBit(occupancyBitboards[!side], static_cast<Square>(target_square))) {
-                moveList.add(encodeMove(source_square, target_square, side, Knight, 0, false, false, false, false));
-            }
-            else {
-                // captures
-                moveList.add(encodeMove(source_square, target_square, side, Knight, 0, true, false, false, false));
-            }
-            clearBit(attacks, static_cast<Square>(target_square));
-        }
-        clearBit(bitboard, static_cast<Square>(source_square));
-    }
-}
+    // check if king attacks
+    if (kingAttacks[square] & getPieces(side, King)) { return true; }
 
-void Board::bishopMoves(Color side, MoveList& moveList) {
-    Bitboard bitboard, attacks;
-    int source_square, target_square;
+    // check if bishop attacks
+    if (getBishopAttacks(square, getOccupancy(All)) & getPieces(side, Bishop)) { return true; }
 
-    bitboard = pieceBitboards[side][Bishop];
+    // check if rook attacks
+    if (getRookAttacks(square, getOccupancy(All)) & getPieces(side, Rook)) { return true; }
 
-    while (bitboard) {
+    // check if queen attacks
+    if (getQueenAttacks(square, getOccupancy(All)) & getPieces(side, Queen)) { return true; }
 
-        source_square = getLSBIndex(bitboard);
-        attacks = getBishopAttacks(source_square, occupancyBitboards[All]) & ~occupancyBitboards[side];
+    return false;
+}
 
-        while (attacks) {
+// every square attacked by a side (occupied or not, own pieces included)
+Bitboard Board::attackedSquares(Color side) const {
+    Bitboard attacks = 0ULL;
+    Bitboard occupancy = getOccupancy(All);
 
-            target_square = getLSBIndex(attacks);
-            // quiet move
-            if (!getBit(occupancyBitboards[!side], static_cast<Square>(target_square))) {
-                moveList.add(encodeMove(source_square, target_square, side, Bishop, 0, false, false, false, false));
-            }
-            else {
-                // captures
-                moveList.add(encodeMove(source_square, target_square, side, Bishop, 0, true, false, false, false));
+    for (int piece = Pawn; piece <= King; piece++) {
+        Bitboard bitboard = getPieces(side, piece);
+        while (bitboard) {
+            int square = getLSBIndex(bitboard);
+            switch (piece) {
+            case Pawn:   attacks |= pawnAttacks[side][square]; break;
+            case Knight: attacks |= knightAttacks[square]; break;
+            case Bishop: attacks |= getBishopAttacks(square, occupancy); break;
+            case Rook:   attacks |= getRookAttacks(square, occupancy); break;
+            case Queen:  attacks |= getQueenAttacks(square, occupancy); break;
+            default:     attacks |= kingAttacks[square]; break;
             }
-            clearBit(attacks, static_cast<Square>(target_square));
+            bitboard &= bitboard - 1;
         }
-        clearBit(bitboard, static_cast<Square>(source_square));
     }
+    return attacks;
 }
 
-void Board::rookMoves(Color side, MoveList& moveList) {
-    Bitboard bitboard, attacks;
-    int source_square, target_square;
-
-    bitboard = pieceBitboards[side][Rook];
-
-    while (bitboard) {
-
-        source_square = getLSBIndex(bitboard);
-        attacks = getRookAttacks(source_square, occupancyBitboards[All]) & ~occupancyBitboards[side];
-
-        while (attacks) {
-
-            target_square = getLSBIndex(attacks);
-            // quiet move
-            if (!getBit(occupancyBitboards[!side], static_cast<Square>(target_square))) {
-                moveList.add(encodeMove(source_square, target_square, side, Rook, 0, false, false, false, false));
+// the generators below are specialized on the side to move (offsets, ranks and castling
+// squares are constants) and on the kind of moves; targets are the squares the pieces other
+// than the king may move to
+template <Color Us, GenType Type>
+void Board::pawnMoves(MoveList& moveList, Bitboard targets) const {
+    constexpr Color Them = Us == White ? Black : White;
+    constexpr int Up = Us == White ? 8 : -8;
+    constexpr Bitboard StartRank = Us == White ? 0xFF00ULL : 0xFF000000000000ULL;
+    constexpr Bitboard PromotionRank = Us == White ? 0xFF000000000000ULL : 0xFF00ULL;
+    Bitboard occupancy = getOccupancy(All);
+
+    for (Bitboard bitboard = getPieces(Us, Pawn); bitboard; bitboard &= bitboard - 1) {
+        int source_square = getLSBIndex(bitboard);
+        int target_square = source_square + Up;
+        bool promotion = PromotionRank >> source_square & 1;
+
+        // pushes, promotions count as captures
+        if (!getBit(occupancy, static_cast<Square>(target_square))) {
+            if (promotion) {
+                if (Type == GEN_CAPTURES || (Type != GEN_QUIETS && getBit(targets, static_cast<Square>(target_square)))) {
+                    moveList.add(encodeMove(source_square, target_square, Us, Pawn, Queen, false, false, false, false));
+                    moveList.add(encodeMove(source_square, target_square, Us, Pawn, Rook, false, false, false, false));
+                    moveList.add(encodeMove(source_square, target_square, Us, Pawn, Bishop, false, false, false, false));
+                    moveList.add(encodeMove(source_square, target_square, Us, Pawn, Knight, false, false, false, false));
+                }
             }
-            else {
-                // captures
-                moveList.add(encodeMove(source_square, target_square, side, Rook, 0, true, false, false, false));
+            else if constexpr (Type != GEN_CAPTURES) {
+                if (getBit(targets, static_cast<Square>(target_square)))
+                    moveList.add(encodeMove(source_square, target_square, Us, Pawn, 0, false, false, false, false));
+                if ((StartRank >> source_square & 1) && !getBit(occupancy, static_cast<Square>(target_square + Up))
+                    && getBit(targets, static_cast<Square>(target_square + Up)))
+                    moveList.add(encodeMove(source_square, target_square + Up, Us, Pawn, 0, false, true, false, false));
             }
-            clearBit(attacks, static_cast<Square>(target_square));
         }
-        clearBit(bitboard, static_cast<Square>(source_square));
-    }
-}
 
-void Board::queenMoves(Color side, MoveList& moveList) {
-    Bitboard bitboard, attacks;
-    int source_square, target_square;
+        if constexpr (Type != GEN_QUIETS) {
+            Bitboard attacks = pawnAttacks[Us][source_square] & colorBitboards[Them];
+            if constexpr (Type == GEN_EVASIONS)
+                attacks &= targets;
+            for (; attacks; attacks &= attacks - 1) {
+                target_square = getLSBIndex(attacks);
+                if (promotion) {
+                    moveList.add(encodeMove(source_square, target_square, Us, Pawn, Queen, true, false, false, false));
+                    moveList.add(encodeMove(source_square, target_square, Us, Pawn, Rook, true, false, false, false));
+                    moveList.add(encodeMove(source_square, target_square, Us, Pawn, Bishop, true, false, false, false));
+                    moveList.add(encodeMove(source_square, target_square, Us, Pawn, Knight, true, false, false, false));
+                }
+                else {
+                    moveList.add(encodeMove(source_square, target_square, Us, Pawn, 0, true, false, false, false));
+                }
+            }
 
-    bitboard = pieceBitboards[side][Queen];
+            // out of check en passant takes the checking pawn or blocks on its square
+            if (enpassant != no_sq && (pawnAttacks[Us][source_square] >> enpassant & 1)
+                && (Type != GEN_EVASIONS || (targets >> enpassant & 1) || (targets >> (enpassant - Up) & 1)))
+                moveList.add(encodeMove(source_square, enpassant, Us, Pawn, 0, true, false, true, false));
+        }
+    }
+}
 
-    while (bitboard) {
+template <Color Us, GenType Type, PieceType Piece>
+void Board::pieceMoves(MoveList& moveList, Bitboard targets) const {
+    constexpr Color Them = Us == White ? Black : White;
+    Bitboard occupancy = getOccupancy(All);
+
+    for (Bitboard bitboard = getPieces(Us, Piece); bitboard; bitboard &= bitboard - 1) {
+        int source_square = getLSBIndex(bitboard);
+        Bitboard attacks;
+        if constexpr (Piece == Knight)
+            attacks = knightAttacks[source_square];
+        else if constexpr (Piece == Bishop)
+            attacks = getBishopAttacks(source_square, occupancy);
+        else if constexpr (Piece == Rook)
+            attacks = getRookAttacks(source_square, occupancy);
+        else
+            attacks = getQueenAttacks(source_square, occupancy);
+
+        for (attacks &= targets; attacks; attacks &= attacks - 1) {
+            int target_square = getLSBIndex(attacks);
+            bool capture = Type == GEN_CAPTURES
+                || (Type != GEN_QUIETS && getBit(colorBitboards[Them], static_cast<Square>(target_square)));
+            moveList.add(encodeMove(source_square, target_square, Us, Piece, 0, capture, false, false, false));
+        }
+    }
+}
 
-        source_square = getLSBIndex(bitboard);
-        attacks = getQueenAttacks(source_square, occupancyBitboards[All]) & ~occupancyBitboards[side];
+template <Color Us, GenType Type>
+void Board::kingMoves(MoveList& moveList) const {
+    constexpr Color Them = Us == White ? Black : White;
+    constexpr int KingSide = Us == White ? wk : bk;
+    constexpr int QueenSide = Us == White ? wq : bq;
+    constexpr Square E = Us == White ? e1 : e8;
+    constexpr Square F = Us == White ? f1 : f8;
+    constexpr Square G = Us == White ? g1 : g8;
+    constexpr Square D = Us == White ? d1 : d8;
+    constexpr Square C = Us == White ? c1 : c8;
+    constexpr Square B = Us == White ? b1 : b8;
+    Bitboard occupancy = getOccupancy(All);
+
+    Bitboard targets = Type == GEN_CAPTURES ? colorBitboards[Them]
+        : Type == GEN_QUIETS ? ~occupancy : ~colorBitboards[Us];
+    for (Bitboard bitboard = getPieces(Us, King); bitboard; bitboard &= bitboard - 1) {
+        int source_square = getLSBIndex(bitboard);
+        for (Bitboard attacks = kingAttacks[source_square] & targets; attacks; attacks &= attacks - 1) {
+            int target_square = getLSBIndex(attacks);
+            bool capture = Type == GEN_CAPTURES
+                || (Type != GEN_QUIETS && getBit(colorBitboards[Them], static_cast<Square>(target_square)));
+            moveList.add(encodeMove(source_square, target_square, Us, King, 0, capture, false, false, false));
+        }
+    }
 
-        while (attacks) {
+    // castling: the squares between king and rook are empty, and the king does not start
+    // on or pass an attacked square (the target square is left to makeMove)
+    if constexpr (Type == GEN_ALL || Type == GEN_QUIETS) {
+        if ((castling & KingSide) && !getBit(occupancy, F) && !getBit(occupancy, G)
+            && !isSquareAttacked(E, Them) && !isSquareAttacked(F, Them))
+            moveList.add(encodeMove(E, G, Us, King, 0, false, false, false, true));
+        if ((castling & QueenSide) && !getBit(occupancy, D) && !getBit(occupancy, C) && !getBit(occupancy, B)
+            && !isSquareAttacked(E, Them) && !isSquareAttacked(D, Them))
+            moveList.add(encodeMove(E, C, Us, King, 0, false, false, false, true));
+    }
+}
 
-            target_square = getLSBIndex(attacks);
-            // quiet move
-            if (!getBit(occupancyBitboards[!side], static_cast<Square>(target_square))) {
-                moveList.add(encodeMove(source_square, target_square, side, Queen, 0, false, false, false, false));
-            }
-            else {
-                // captures
-                moveList.add(encodeMove(source_square, target_square, side, Queen, 0, true, false, false, false));
-            }
-            clearBit(attacks, static_cast<Square>(target_square));
+template <Color Us, GenType Type>
+void Board::generate(MoveList& moveList) const {
+    constexpr Color Them = Us == White ? Black : White;
+    Bitboard targets;
+
+    if constexpr (Type == GEN_EVASIONS) {
+        int king = getLSBIndex(getPieces(Us, King));
+        Bitboard occupancy = getOccupancy(All);
+        Bitboard rookCheckers = getRookAttacks(king, occupancy) & (getPieces(Them, Rook) | getPieces(Them, Queen));
+        Bitboard bishopCheckers = getBishopAttacks(king, occupancy) & (getPieces(Them, Bishop) | getPieces(Them, Queen));
+        Bitboard checkers = rookCheckers | bishopCheckers
+            | (knightAttacks[king] & getPieces(Them, Knight))
+            | (pawnAttacks[Us][king] & getPieces(Them, Pawn));
+
+        if (!checkers) {
+            generate<Us, GEN_ALL>(moveList);
+            return;
+        }
+        // with two checkers only the king moves; a single slider can also be blocked on the
+        // squares where its line meets the king's
+        if (!(checkers & (checkers - 1))) {
+            int checker = getLSBIndex(checkers);
+            targets = checkers;
+            if (rookCheckers)
+                targets |= getRookAttacks(king, occupancy) & getRookAttacks(checker, occupancy);
+            else if (bishopCheckers)
+                targets |= getBishopAttacks(king, occupancy) & getBishopAttacks(checker, occupancy);
+
+            pawnMoves<Us, Type>(moveList, targets);
+            pieceMoves<Us, Type, Knight>(moveList, targets);
+            pieceMoves<Us, Type, Bishop>(moveList, targets);
+            pieceMoves<Us, Type, Rook>(moveList, targets);
+            pieceMoves<Us, Type, Queen>(moveList, targets);
         }
-        clearBit(bitboard, static_cast<Square>(source_square));
+        kingMoves<Us, Type>(moveList);
+        return;
     }
+    else {
+        targets = Type == GEN_CAPTURES ? colorBitboards[Them]
+            : Type == GEN_QUIETS ? ~getOccupancy(All) : ~colorBitboards[Us];
+    }
+
+    pawnMoves<Us, Type>(moveList, targets);
+    pieceMoves<Us, Type, Knight>(moveList, targets);
+    pieceMoves<Us, Type, Bishop>(moveList, targets);
+    pieceMoves<Us, Type, Rook>(moveList, targets);
+    pieceMoves<Us, Type, Queen>(moveList, targets);
+    kingMoves<Us, Type>(moveList);
 }
 
 MoveList Board::generateMoves() {
-
     MoveList moves;
-    pawnMoves(static_cast<Color>(side), moves);
-    knightMoves(static_cast<Color>(side), moves);
-    bishopMoves(static_cast<Color>(side), moves);
-    rookMoves(static_cast<Color>(side), moves);
-    queenMoves(static_cast<Color>(side), moves);
-    kingMoves(static_cast<Color>(side), moves);
+    generateMoves(moves);
     return moves;
 }
 
+void Board::generateMoves(MoveList& moves, GenType type) {
+    moves.clear();
+    bool white = side == White;
+    switch (type) {
+    case GEN_CAPTURES: white ? generate<White, GEN_CAPTURES>(moves) : generate<Black, GEN_CAPTURES>(moves); break;
+    case GEN_QUIETS:   white ? generate<White, GEN_QUIETS>(moves) : generate<Black, GEN_QUIETS>(moves); break;
+    case GEN_EVASIONS: white ? generate<White, GEN_EVASIONS>(moves) : generate<Black, GEN_EVASIONS>(moves); break;
+    default:           white ? generate<White, GEN_ALL>(moves) : generate<Black, GEN_ALL>(moves); break;
+    }
+}
+
 bool Board::makeMove(Move move, MoveMode mode) {
     // parse move
     MoveStore m(move);
@@ -1290,40 +2135,44 @@ bool Board::makeMove(Move move, MoveMode mode) {
 
         // Save current state into previous state
         saveState();
-        // make move
-        clearBit(pieceBitboards[m.getColor()][m.getPiece()], static_cast<Square>(m.getSource()));
-        setBit(pieceBitboards[m.getColor()][m.getPiece()], static_cast<Square>(m.getTarget()));
-
-        // handling capture moves
-        if (m.isCapture()) {
-            // loop over bitboards to find which piece is being captured
-            for (int piece = Pawn; piece <= King; piece++) {
-                // if there's an opposing piece on the target square
-                if (getBit(pieceBitboards[!m.getColor()][piece], static_cast<Square>(m.getTarget()))) {
-                    // remove it from corresponding bitboard
-                    clearBit(pieceBitboards[!m.getColor()][piece], static_cast<Square>(m.getTarget()));
-                    break;
-                }
-            }
+        pushAccumulator();
+
+        // captures and pawn moves are irreversible, they reset the fifty-move counter
+        if (m.isCapture() || m.getPiece() == Pawn)
+            halfmoveClock = 0;
+        else
+            halfmoveClock++;
+
+        // handling capture moves, the mailbox has the captured piece
+        if (m.isCapture() && !m.isEnPassant()) {
+            int captured = pieceOn(m.getTarget());
+            if (captured >= 0)
+                removePiece(!m.getColor(), captured, m.getTarget());
         }
 
-        if (m.getPromoted()) {
-            // erase the pawn from the target square
-            clearBit(pieceBitboards[m.getColor()][Pawn], static_cast<Square>(m.getTarget()));
+        // make move
+        removePiece(m.getColor(), m.getPiece(), m.getSource());
 
+        if (m.getPromoted()) {
             // set up promoted piece on chess board
-            setBit(pieceBitboards[m.getColor()][m.getPromoted()], static_cast<Square>(m.getTarget()));
+            addPiece(m.getColor(), m.getPromoted(), m.getTarget());
+        }
+        else {
+            addPiece(m.getColor(), m.getPiece(), m.getTarget());
         }
 
         if (m.isEnPassant()) {
             int square_offset = (m.getColor() == White) ? -8 : 8;
-            clearBit(pieceBitboards[!m.getColor()][Pawn], static_cast<Square>(m.getTarget() + square_offset));
+            removePiece(!m.getColor(), Pawn, m.getTarget() + square_offset);
         }
+        if (enpassant != no_sq)
+            hashKey ^= enpassantKeys[enpassant];
         enpassant = no_sq;
 
         if (m.isDoublePush()) {
             int square_offset = (m.getColor() == White) ? -8 : 8;
             enpassant = m.getTarget() + square_offset;
+            hashKey ^= enpassantKeys[enpassant];
         }
 
         if (m.isCastling()) {
@@ -1332,59 +2181,54 @@ bool Board::makeMove(Move move, MoveMode mode) {
                 // white castles king side
             case (g1):
                 // move H rook
-                clearBit(pieceBitboards[White][Rook], h1);
-                setBit(pieceBitboards[White][Rook], f1);
+                removePiece(White, Rook, h1);
+                addPiece(White, Rook, f1);
                 break;
 
                 // white castles queen side
             case (c1):
                 // move A rook
-                clearBit(pieceBitboards[White][Rook], a1);
-                setBit(pieceBitboards[White][Rook], d1);
+                removePiece(White, Rook, a1);
+                addPiece(White, Rook, d1);
                 break;
 
                 // black castles king side
             case (g8):
                 // move H rook
-                clearBit(pieceBitboards[Black][Rook], h8);
-                setBit(pieceBitboards[Black][Rook], f8);
+                removePiece(Black, Rook, h8);
+                addPiece(Black, Rook, f8);
                 break;
 
                 // black castles queen side
             case (c8):
                 // move A rook
-                clearBit(pieceBitboards[Black][Rook], a8);
-                setBit(pieceBitboards[Black][Rook], d8);
+                removePiece(Black, Rook, a8);
+                addPiece(Black, Rook, d8);
                 break;
             }
         }
         // update castling rights
+        hashKey ^= castlingKeys[castling];
         castling &= castling_rights[m.getSource()];
         castling &= castling_rights[m.getTarget()];
-
-        // Set occupancy boards
-        memset(occupancyBitboards, 0ULL, sizeof(occupancyBitboards));
-        for (int color = White; color <= Black; color++) {
-            for (int piece = Pawn; piece <= King; piece++) {
-                occupancyBitboards[color] |= pieceBitboards[color][piece];
-            }
-        }
-        occupancyBitboards[All] |= occupancyBitboards[White];
-        occupancyBitboards[All] |= occupancyBitboards[Black];
+        hashKey ^= castlingKeys[castling];
 
         // std::cout << side << " made move: " << std::endl;
         // change side
         side ^= 1;
+        hashKey ^= sideKey;
         // std::cout << side << " changed to : " << std::endl;
         // make sure king of current side is not being attacked by the other side after this side's move
-        if (isSquareAttacked(static_cast<Square>(getLSBIndex(pieceBitboards[!side][King])), static_cast<Color>(side))) {
+        if (isSquareAttacked(static_cast<Square>(getLSBIndex(getPieces(!side, King))), static_cast<Color>(side))) {
             // take move back
             takeBack();
             // return illegal move
             return false;
         }
         else {
-
+            if (++gamePly == static_cast<int>(keyHistory.size()))
+                keyHistory.resize(keyHistory.size() * 2);
+            keyHistory[gamePly] = hashKey;
             return true;
         }
     }
@@ -1483,7 +2327,7 @@ void Board::printBoard() {
             int piece_color = -1;
             for (int color = White; color <= Black; color++) {
                 for (int piece = Pawn; piece <= King; piece++) {
-                    if (getBit(pieceBitboards[color][piece], static_cast<Square>(square))) {
+                    if (getBit(getPieces(color, piece), static_cast<Square>(square))) {
                         piece_index = piece;
                         piece_color = color;
                         break;
@@ -1530,7 +2374,7 @@ void Board::printPieceboards() {
     // print out initial boards
     for (int color = White; color <= Black; color++) {
         for (int piece = Pawn; piece <= King; piece++) {
-            Bitboard bitboard = pieceBitboards[color][piece];
+            Bitboard bitboard = getPieces(color, piece);
             std::cout << ColorNames[color] << " " << PieceTypeNames[piece] << " has bitboard: " << "\n";
             printBitboard(bitboard);
         }
@@ -1539,12 +2383,14 @@ void Board::printPieceboards() {
 
 void Board::printOccupancyboards() {
     for (int color = White; color <= All; color++) {
-        Bitboard bitboard = occupancyBitboards[color];
+        Bitboard bitboard = getOccupancy(color);
         std::cout << ColorNames[color] << " " << " has occupancy bitboard: " << "\n";
         printBitboard(bitboard);
     }
 }
 
+// debug playground, build with -DCHESS_PLAYGROUND (the python module and uci target have their own entry points)
+#ifdef CHESS_PLAYGROUND
 int main()
 {
     std::cout << "initializing tables" << std::endl;
@@ -1575,7 +2421,7 @@ int main()
     //board.parseFEN(tricky_position);
     //board.perft_test(6); // 8031647685
 
-    //board.parseFEN(start_position);
+    //board.parseFEN(START_FEN);
     //MoveList legal_moves = board.legalMoves();
     //for (size_t i = 0; legal_moves.size(); i++) {
     //    std::cout << legal_moves[i] << std::endl;
@@ -1611,6 +2457,7 @@ int main()
 
     return 0;
 }
+#endif
 
 
 // g++ ../*.cpp -O3 -march=native -flto -fno-exceptions -fno-rtti -std=c++17 -DNDEBUG -DUSE_POPCNT -DUSE_SSE41 -DUSE_BMI2
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include <vector>
 #include <cstring>
 #include <string>
+#include <string_view>
+
+#include "nnue.h"
 
 using Bitboard = uint64_t;
 using Move = uint32_t;
@@ -32,6 +35,10 @@ enum CastlingType : uint8_t {
 
 enum MoveMode : uint8_t { ALL_MOVES, CAPTURES_ONLY };
 
+// generateMoves output: captures are captures, en passant and every promotion, quiets the
+// rest; evasions are the moves that may get out of check (all moves when not in check)
+enum GenType : uint8_t { GEN_ALL, GEN_CAPTURES, GEN_QUIETS, GEN_EVASIONS };
+
 struct Piece {
     PieceType type;
     Color color;
@@ -134,6 +141,11 @@ Bitboard getBishopAttacks(int square, Bitboard occupancy);
 Bitboard getRookAttacks(int square, Bitboard occupancy);
 Bitboard getQueenAttacks(int square, Bitboard occupancy);
 
+// precomputed leaper attack tables
+extern Bitboard pawnAttacks[2][64];
+extern Bitboard knightAttacks[64];
+extern Bitboard kingAttacks[64];
+
 
 struct State {
     Bitboard pieces[2][6];    // [color][piece]
@@ -144,32 +156,167 @@ struct State {
     bool in_check;
 };
 
+// mailbox entry of an empty square, others hold color * 6 + piece
+constexpr uint8_t NO_PIECE = 15;
+
+// everything makeMove changes, saved before a move and restored to take it back. The
+// eight bitboards fill the first cache line and the rest of the position the second, a
+// piece of a color is typeBitboards[piece] & colorBitboards[color]
+struct alignas(64) BoardState {
+    Bitboard typeBitboards[6];     // [piece], both colors
+    Bitboard colorBitboards[2];    // [color], together the occupancy
+
+    // zobrist keys of the full position and of the pawns only
+    uint64_t hashKey, pawnKey;
+
+    // 4 bits per square, the low half of a byte for the even square
+    uint8_t mailbox[32];
+
+    // incrementally updated material + piece-square sums (white minus black) and game phase
+    int16_t mgScore, egScore;
+
+    // plies since parseFEN (keyHistory index) and since the last capture or pawn move
+    int32_t gamePly;
+    uint16_t halfmoveClock;
+
+    uint8_t side, castling, enpassant;
+    uint8_t gamePhase;
+    uint8_t nnuePly;
+};
+
+static_assert(sizeof(BoardState) == 128, "BoardState spans two cache lines");
+
+// what push() needs to take a move back
+struct UndoEntry {
+    BoardState state;
+    Move move;
+};
+
+// parseFEN / parseEPD result, the board is left unchanged on any error
+enum FENError : uint8_t {
+    FEN_OK,
+    FEN_BAD_PLACEMENT,    // not 8 ranks of 8 files, unknown piece or pawn on a back rank
+    FEN_BAD_KINGS,        // not exactly one king per side
+    FEN_BAD_SIDE,
+    FEN_BAD_CASTLING,
+    FEN_BAD_ENPASSANT,    // malformed, wrong rank or no pawn that just double pushed
+    FEN_BAD_COUNTERS,     // halfmove clock / fullmove number not numbers, or extra fields
+    FEN_BAD_OPERATIONS    // EPD operations
+};
+
+const char* fenErrorString(FENError error);
+
+// how a game stands, draws by their rule
+enum GameStatus : uint8_t {
+    ONGOING,
+    CHECKMATE,
+    STALEMATE,
+    FIFTY_MOVES,
+    REPETITION,
+    INSUFFICIENT_MATERIAL
+};
+
+// longest FEN toFEN writes, terminating zero included
+constexpr size_t FEN_MAX_LENGTH = 128;
+// standard start position
+constexpr const char* START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// EPD operation "opcode operand ...;", views into the parsed string with the quotes of
+// a single quoted operand removed
+struct EPDOperation {
+    std::string_view opcode;
+    std::string_view operand;
+};
+
+// get time in milliseconds
+uint64_t get_time_ms();
+
+// longest move strings moveToUCI / Board::moveToSAN write, terminating zero included
+constexpr size_t UCI_MAX_LENGTH = 6;
+constexpr size_t SAN_MAX_LENGTH = 8;
+
+// long algebraic move string (e.g. "e7e8q"), zero-terminated; returns its length or 0
+// if size is too small
+size_t moveToUCI(Move move, char* out, size_t size);
+std::string moveToString(Move move);
+
 // Board methods
-class Board {
+class Board : private BoardState {
 public:
     Board();
+    // copies take the position, its key history and (with undo) the undo stack; the NNUE
+    // accumulators stay with each board and are rebuilt by the next network evaluation
+    Board(const Board& other, bool undo = true);
+    Board& operator=(const Board& other);
+    Board(Board&&) = default;
+    Board& operator=(Board&&) = default;
+
     // initialization methods
     void initTables();
     void initLeaperPieces();
     void initSliderPieces();
+    void initZobristKeys();
 
     // I/O methods
-    void parseFEN(const std::string& fen);
+    // single pass over the string without allocations; the move counters are optional
+    // and castling rights without their king and rook in place are dropped
+    FENError parseFEN(std::string_view fen);
+    // the four position fields and operations; hmvc / fmvn set the move counters
+    FENError parseEPD(std::string_view epd, std::vector<EPDOperation>& operations);
+    // a position from its parts with the checks of parseFEN (castling rights are cleaned
+    // the same way), enpassant is no_sq for none; the board is unchanged on error
+    FENError setPosition(const Bitboard pieces[2][6], int side, int castling, int enpassant,
+        int halfmove = 0, int fullmove = 1);
+    // writes a zero-terminated FEN, returns its length or 0 if size is too small
+    size_t toFEN(char* out, size_t size) const;
+    std::string toFEN() const;
+
+    // compact binary image: pieces, side, castling, en passant, move counters and the
+    // keys since the last capture or pawn move (for repetitions); no undo stack
+    std::string serialize() const;
+    bool deserialize(const std::string& data);
 
     // attacking methods
     bool isSquareAttacked(Square square, Color side) const;
-    void pawnMoves(Color side, MoveList& moveList);
-    void knightMoves(Color side, MoveList& moveList);
-    void bishopMoves(Color side, MoveList& moveList);
-    void rookMoves(Color side, MoveList& moveList);
-    void queenMoves(Color side, MoveList& moveList);
-    void kingMoves(Color side, MoveList& moveList);
+    Bitboard attackedSquares(Color side) const;
 
     // move methods
+    // pseudo-legal moves of the side to move
     MoveList generateMoves();
+    // into a caller's list, which is cleared first
+    void generateMoves(MoveList& moves, GenType type = GEN_ALL);
     bool makeMove(Move move, MoveMode mode);
-    Move parseMove(const std::string& move_string);
+    // the legal move of a long algebraic string ("e7e8q"), 0 if it names none
+    Move parseMove(std::string_view move);
+    // the legal move a SAN string names, 0 if it names none or is ambiguous
+    Move parseSAN(std::string_view san);
+    // the legal move from source to target (promoted: Knight..Queen for promotions)
+    // without generating moves, 0 if there is none
+    Move findMove(int source, int target, int promoted = 0);
+    // SAN of a legal move with disambiguation and check / mate suffix, zero-terminated;
+    // returns its length or 0 if size is too small
+    size_t moveToSAN(Move move, char* out, size_t size);
+    std::string moveToSAN(Move move);
     MoveList legalMoves();
+    void makeNullMove();
+
+    // makeMove / take back with a native undo stack, cleared by parseFEN
+    bool push(Move move);
+    Move pop();                 // the move taken back, 0 with an empty stack
+    size_t undoDepth() const;
+
+    // draw detection from the position history
+    bool isRepetition(int times = 1) const;
+    bool isDraw();
+    // kings alone or with a single minor piece, no mate is possible
+    bool insufficientMaterial() const;
+    // stops at the first legal move found, so it costs a few attack lookups in most positions
+    bool hasLegalMove();
+    GameStatus status();
+
+    // make / takeBack
+    void copyState(BoardState& state) const;
+    void restoreState(const BoardState& state);
 
 
     // debug helper methods
@@ -182,18 +329,56 @@ public:
 
     // state methods
     State getState() const;
+    uint64_t getHashKey() const;
+    int getSide() const;
+    int getCastling() const;
+    int getEnpassant() const;
+    Bitboard getPieces(int color, int piece) const;
+    Bitboard getOccupancy(int color) const;
+    int pieceOn(int square) const;
+    bool inCheck() const;
+    uint64_t getPawnKey() const;
+    int getHalfmoveClock() const;
+    int getFullmoveNumber() const;
+
+    // evaluation (centipawns from the side to move's point of view)
+    int evaluate() const;
+    int evaluateNNUE();
 
     // perft
     uint64_t perft_driver(int depth);
     void perft_test(int depth);
 
 private:
-    Bitboard pieceBitboards[2][6]; // [color][piece]
-    Bitboard occupancyBitboards[3]; // [color]
-
-    int side;
-    int enpassant;
-    int castling;
+    // the fullmove number is derived from gamePly: (moveOffset + gamePly) / 2 + 1
+    int moveOffset;
+
+    // hash keys of every position since parseFEN, keyHistory[gamePly] is the current one;
+    // takeBack only restores gamePly, the entries above it are overwritten by the next move
+    std::vector<uint64_t> keyHistory;
+
+    // moves played with push
+    std::vector<UndoEntry> undoStack;
+
+    // NNUE accumulators [ply], allocated on the first network evaluation
+    std::vector<NNUEEntry> nnueStack;
+
+    // piece placement helpers, keep the incremental scores in sync
+    void placePiece(int color, int piece, int square);
+    void addPiece(int color, int piece, int square);
+    void removePiece(int color, int piece, int square);
+    void resetScores();
+    void resetKeys();
+    void pushAccumulator();
+    void markDirty(int color, int piece, int square, int sign);
+    void copyFrom(const Board& other, bool undo);
+    FENError readPosition(std::string_view text, bool counters);
+
+    // move generation specialized on the side to move and GenType
+    template <Color Us, GenType Type> void generate(MoveList& moveList) const;
+    template <Color Us, GenType Type> void pawnMoves(MoveList& moveList, Bitboard targets) const;
+    template <Color Us, GenType Type, PieceType Piece> void pieceMoves(MoveList& moveList, Bitboard targets) const;
+    template <Color Us, GenType Type> void kingMoves(MoveList& moveList) const;
 };
 
 
@@ -0,0 +1,407 @@
+#include <cstdint>
+#include <cstring>
+#include <array>
+
+#include "chess.h"
+#include "evaluate.h"
+
+// PeSTO material and piece-square tables (https://www.chessprogramming.org/PeSTO%27s_Evaluation_Function)
+// tables are written from white's point of view with a8 as the first entry
+static constexpr int mgValue[6] = { 82, 337, 365, 477, 1025, 0 };
+static constexpr int egValue[6] = { 94, 281, 297, 512, 936, 0 };
+
+static constexpr int mgTables[6][64] = {
+    // pawn
+    {
+      0,   0,   0,   0,   0,   0,  0,   0,
+     98, 134,  61,  95,  68, 126, 34, -11,
+     -6,   7,  26,  31,  65,  56, 25, -20,
+    -14,  13,   6,  21,  23,  12, 17, -23,
+    -27,  -2,  -5,  12,  17,   6, 10, -25,
+    -26,  -4,  -4, -10,   3,   3, 33, -12,
+    -35,  -1, -20, -23, -15,  24, 38, -22,
+      0,   0,   0,   0,   0,   0,  0,   0,
+    },
+    // knight
+    {
+    -167, -89, -34, -49,  61, -97, -15, -107,
+     -73, -41,  72,  36,  23,  62,   7,  -17,
+     -47,  60,  37,  65,  84, 129,  73,   44,
+      -9,  17,  19,  53,  37,  69,  18,   22,
+     -13,   4,  16,  13,  28,  19,  21,   -8,
+     -23,  -9,  12,  10,  19,  17,  25,  -16,
+     -29, -53, -12,  -3,  -1,  18, -14,  -19,
+    -105, -21, -58, -33, -17, -28, -19,  -23,
+    },
+    // bishop
+    {
+    -29,   4, -82, -37, -25, -42,   7,  -8,
+    -26,  16, -18, -13,  30,  59,  18, -47,
+    -16,  37,  43,  40,  35,  50,  37,  -2,
+     -4,   5,  19,  50,  37,  37,   7,  -2,
+     -6,  13,  13,  26,  34,  12,  10,   4,
+      0,  15,  15,  15,  14,  27,  18,  10,
+      4,  15,  16,   0,   7,  21,  33,   1,
+    -33,  -3, -14, -21, -13, -12, -39, -21,
+    },
+    // rook
+    {
+     32,  42,  32,  51, 63,  9,  31,  43,
+     27,  32,  58,  62, 80, 67,  26,  44,
+     -5,  19,  26,  36, 17, 45,  61,  16,
+    -24, -11,   7,  26, 24, 35,  -8, -20,
+    -36, -26, -12,  -1,  9, -7,   6, -23,
+    -45, -25, -16, -17,  3,  0,  -5, -33,
+    -44, -16, -20,  -9, -1, 11,  -6, -71,
+    -19, -13,   1,  17, 16,  7, -37, -26,
+    },
+    // queen
+    {
+    -28,   0,  29,  12,  59,  44,  43,  45,
+    -24, -39,  -5,   1, -16,  57,  28,  54,
+    -13, -17,   7,   8,  29,  56,  47,  57,
+    -27, -27, -16, -16,  -1,  17,  -2,   1,
+     -9, -26,  -9, -10,  -2,  -4,   3,  -3,
+    -14,   2, -11,  -2,  -5,   2,  14,   5,
+    -35,  -8,  11,   2,   8,  15,  -3,   1,
+     -1, -18,  -9,  10, -15, -25, -31, -50,
+    },
+    // king
+    {
+    -65,  23,  16, -15, -56, -34,   2,  13,
+     29,  -1, -20,  -7,  -8,  -4, -38, -29,
+     -9,  24,   2, -16, -20,   6,  22, -22,
+    -17, -20, -12, -27, -30, -25, -14, -36,
+    -49,  -1, -27, -39, -46, -44, -33, -51,
+    -14, -14, -22, -46, -44, -30, -15, -27,
+      1,   7,  -8, -64, -43, -16,   9,   8,
+    -15,  36,  12, -54,   8, -28,  24,  14,
+    },
+};
+
+static constexpr int egTables[6][64] = {
+    // pawn
+    {
+      0,   0,   0,   0,   0,   0,   0,   0,
+    178, 173, 158, 134, 147, 132, 165, 187,
+     94, 100,  85,  67,  56,  53,  82,  84,
+     32,  24,  13,   5,  -2,   4,  17,  17,
+     13,   9,  -3,  -7,  -7,  -8,   3,  -1,
+      4,   7,  -6,   1,   0,  -5,  -1,  -8,
+     13,   8,   8,  10,  13,   0,   2,  -7,
+      0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    // knight
+    {
+    -58, -38, -13, -28, -31, -27, -63, -99,
+    -25,  -8, -25,  -2,  -9, -25, -24, -52,
+    -24, -20,  10,   9,  -1,  -9, -19, -41,
+    -17,   3,  22,  22,  22,  11,   8, -18,
+    -18,  -6,  16,  25,  16,  17,   4, -18,
+    -23,  -3,  -1,  15,  10,  -3, -20, -22,
+    -42, -20, -10,  -5,  -2, -20, -23, -44,
+    -29, -51, -23, -15, -22, -18, -50, -64,
+    },
+    // bishop
+    {
+    -14, -21, -11,  -8, -7,  -9, -17, -24,
+     -8,  -4,   7, -12, -3, -13,  -4, -14,
+      2,  -8,   0,  -1, -2,   6,   0,   4,
+     -3,   9,  12,   9, 14,  10,   3,   2,
+     -6,   3,  13,  19,  7,  10,  -3,  -9,
+    -12,  -3,   8,  10, 13,   3,  -7, -15,
+    -14, -18,  -7,  -1,  4,  -9, -15, -27,
+    -23,  -9, -23,  -5, -9, -16,  -5, -17,
+    },
+    // rook
+    {
+    13, 10, 18, 15, 12,  12,   8,   5,
+    11, 13, 13, 11, -3,   3,   8,   3,
+     7,  7,  7,  5,  4,  -3,  -5,  -3,
+     4,  3, 13,  1,  2,   1,  -1,   2,
+     3,  5,  8,  4, -5,  -6,  -8, -11,
+    -4,  0, -5, -1, -7, -12,  -8, -16,
+    -6, -6,  0,  2, -9,  -9, -11,  -3,
+    -9,  2,  3, -1, -5, -13,   4, -20,
+    },
+    // queen
+    {
+     -9,  22,  22,  27,  27,  19,  10,  20,
+    -17,  20,  32,  41,  58,  25,  30,   0,
+    -20,   6,   9,  49,  47,  35,  19,   9,
+      3,  22,  24,  45,  57,  40,  57,  36,
+    -18,  28,  19,  47,  31,  34,  39,  23,
+    -16, -27,  15,   6,   9,  17,  10,   5,
+    -22, -23, -30, -16, -16, -23, -36, -32,
+    -33, -28, -22, -43,  -5, -32, -20, -41,
+    },
+    // king
+    {
+    -74, -35, -18, -18, -11,  15,   4, -17,
+    -12,  17,  14,  17,  17,  38,  23,  11,
+     10,  17,  23,  15,  20,  45,  44,  13,
+     -8,  22,  24,  27,  26,  33,  26,   3,
+    -18,  -4,  21,  24,  27,  23,   9, -11,
+    -19,  -3,  11,  21,  23,  16,   7,  -9,
+    -27, -11,   4,  13,  14,   4,  -5, -17,
+    -53, -34, -21, -11, -28, -14, -24, -43
+    },
+};
+
+const int gamePhaseInc[6] = { 0, 1, 1, 2, 4, 0 };
+
+// fold material into the piece-square tables and mirror them for both colors
+static constexpr PieceSquareTable buildPieceSquare(const int values[6], const int tables[6][64]) {
+    PieceSquareTable table{};
+    for (int piece = Pawn; piece <= King; piece++) {
+        for (int square = a1; square <= h8; square++) {
+            table[White][piece][square] = values[piece] + tables[piece][square ^ 56];
+            table[Black][piece][square] = values[piece] + tables[piece][square];
+        }
+    }
+    return table;
+}
+
+constexpr PieceSquareTable mgPieceSquare = buildPieceSquare(mgValue, mgTables);
+constexpr PieceSquareTable egPieceSquare = buildPieceSquare(egValue, egTables);
+
+// mobility weights per attacked square [piece], centered on a typical move count
+static const int mobilityCenter[6] = { 0, 4, 6, 7, 13, 0 };
+static const int mgMobility[6] = { 0, 4, 3, 2, 1, 0 };
+static const int egMobility[6] = { 0, 4, 3, 4, 2, 0 };
+
+// king safety: attack units per piece type hitting the king zone
+static const int kingAttackWeight[6] = { 0, 2, 2, 3, 5, 0 };
+
+// attack units -> middlegame penalty, saturates for overwhelming attacks
+static const int kingSafetyTable[64] = {
+      0,   0,   1,   2,   3,   5,   7,   9,  12,  15,
+     18,  22,  26,  30,  35,  39,  44,  50,  56,  62,
+     68,  75,  82,  85,  89,  97, 105, 113, 122, 131,
+    140, 150, 169, 180, 191, 202, 213, 225, 237, 248,
+    260, 272, 283, 295, 307, 319, 330, 342, 354, 366,
+    377, 389, 401, 412, 424, 436, 448, 459, 471, 483,
+    494, 500, 500, 500
+};
+
+// pawn structure terms [relative rank] for passed pawns
+static const int mgPassed[8] = { 0, 5, 10, 15, 25, 45, 70, 0 };
+static const int egPassed[8] = { 0, 10, 20, 35, 60, 100, 150, 0 };
+static const int mgDoubled = -10, egDoubled = -20;
+static const int mgIsolated = -10, egIsolated = -15;
+
+// king shelter: own pawn one / two ranks in front of the king, or an open file
+static const int shelterNear = 12, shelterFar = 6, shelterOpen = -12;
+
+struct PawnMasks {
+    Bitboard file[8];
+    Bitboard adjacentFiles[8];
+    Bitboard passed[2][64];   // squares in front on the same and adjacent files
+};
+
+static const PawnMasks pawnMasks = [] {
+    PawnMasks masks{};
+    for (int file = 0; file < 8; file++) {
+        masks.file[file] = 0x0101010101010101ULL << file;
+    }
+    for (int file = 0; file < 8; file++) {
+        masks.adjacentFiles[file] = (file > 0 ? masks.file[file - 1] : 0ULL) | (file < 7 ? masks.file[file + 1] : 0ULL);
+    }
+    for (int square = a1; square <= h8; square++) {
+        int rank = square / 8;
+        Bitboard files = masks.file[square % 8] | masks.adjacentFiles[square % 8];
+        Bitboard above = rank < 7 ? ~0ULL << ((rank + 1) * 8) : 0ULL;
+        Bitboard below = rank > 0 ? ~0ULL >> ((8 - rank) * 8) : 0ULL;
+        masks.passed[White][square] = files & above;
+        masks.passed[Black][square] = files & below;
+    }
+    return masks;
+    }();
+
+struct PawnTable {
+    PawnEntry entries[PAWN_TABLE_SIZE];
+    PawnTableStats stats;
+};
+
+static thread_local PawnTable pawnTable;
+
+PawnTableStats pawnTableStats() {
+    return pawnTable.stats;
+}
+
+void clearPawnTable() {
+    memset(&pawnTable, 0, sizeof(pawnTable));
+}
+
+// shelter of the three files around the king, only pawns in front of it count
+static int kingShelter(int color, int kingSquare, Bitboard pawns) {
+    int kingFile = kingSquare % 8;
+    int kingRank = kingSquare / 8;
+    int forward = color == White ? 1 : -1;
+    int shelter = 0;
+
+    for (int file = kingFile - 1; file <= kingFile + 1; file++) {
+        if (file < 0 || file > 7)
+            continue;
+
+        int near = (kingRank + forward) * 8 + file;
+        int far = (kingRank + 2 * forward) * 8 + file;
+
+        if (near >= 0 && near < 64 && (pawns & (1ULL << near)))
+            shelter += shelterNear;
+        else if (far >= 0 && far < 64 && (pawns & (1ULL << far)))
+            shelter += shelterFar;
+        else if (!(pawns & pawnMasks.file[file]))
+            shelter += shelterOpen;
+    }
+    return shelter;
+}
+
+// structure terms that only depend on the pawns, cached by the pawn key
+static const PawnEntry& probePawnTable(uint64_t key, const Bitboard types[6], const Bitboard colors[2]) {
+
+    PawnEntry& entry = pawnTable.entries[key & (PAWN_TABLE_SIZE - 1)];
+    pawnTable.stats.probes++;
+
+    if (entry.key == key && key) {
+        pawnTable.stats.hits++;
+    }
+    else {
+        entry.key = key;
+        entry.mg = entry.eg = 0;
+        entry.kingSquare[White] = entry.kingSquare[Black] = no_sq;
+
+        for (int color = White; color <= Black; color++) {
+            int sign = color == White ? 1 : -1;
+            Bitboard own = types[Pawn] & colors[color];
+            Bitboard enemy = types[Pawn] & colors[!color];
+            Bitboard bitboard = own;
+            entry.passed[color] = 0ULL;
+
+            while (bitboard) {
+                int square = getLSBIndex(bitboard);
+                int file = square % 8;
+                int relativeRank = color == White ? square / 8 : 7 - square / 8;
+
+                // doubled, counted once per extra pawn on the file
+                if (own & pawnMasks.file[file] & ~(1ULL << square) & pawnMasks.passed[color][square]) {
+                    entry.mg += sign * mgDoubled;
+                    entry.eg += sign * egDoubled;
+                }
+
+                // isolated
+                if (!(own & pawnMasks.adjacentFiles[file])) {
+                    entry.mg += sign * mgIsolated;
+                    entry.eg += sign * egIsolated;
+                }
+
+                // passed
+                if (!(enemy & pawnMasks.passed[color][square])) {
+                    entry.passed[color] |= 1ULL << square;
+                    entry.mg += sign * mgPassed[relativeRank];
+                    entry.eg += sign * egPassed[relativeRank];
+                }
+                clearBit(bitboard, static_cast<Square>(square));
+            }
+        }
+    }
+
+    // shelter depends on the king square too, refresh it when the king moved
+    for (int color = White; color <= Black; color++) {
+        int kingSquare = getLSBIndex(types[King] & colors[color]);
+        if (entry.kingSquare[color] != kingSquare) {
+            entry.kingSquare[color] = kingSquare;
+            entry.shelter[color] = kingSquare >= 0 ? kingShelter(color, kingSquare, types[Pawn] & colors[color]) : 0;
+        }
+    }
+    return entry;
+}
+
+int Board::evaluate() const {
+
+    // the incremental sums are already white minus black
+    int mg[2] = { mgScore, 0 };
+    int eg[2] = { egScore, 0 };
+
+    // squares attacked by pawns are not counted towards mobility
+    Bitboard pawnControl[2] = { 0ULL, 0ULL };
+    for (int color = White; color <= Black; color++) {
+        Bitboard pawns = getPieces(color, Pawn);
+        while (pawns) {
+            int square = getLSBIndex(pawns);
+            pawnControl[color] |= pawnAttacks[color][square];
+            clearBit(pawns, static_cast<Square>(square));
+        }
+    }
+
+    for (int color = White; color <= Black; color++) {
+
+        int enemy = !color;
+        int enemyKing = getLSBIndex(getPieces(enemy, King));
+        Bitboard kingZone = enemyKing >= 0 ? kingAttacks[enemyKing] | (1ULL << enemyKing) : 0ULL;
+        Bitboard mobilityArea = ~colorBitboards[color] & ~pawnControl[enemy];
+
+        int attackUnits = 0;
+        int attackers = 0;
+
+        for (int piece = Knight; piece <= Queen; piece++) {
+            Bitboard bitboard = getPieces(color, piece);
+
+            while (bitboard) {
+                int square = getLSBIndex(bitboard);
+                Bitboard attacks;
+
+                switch (piece) {
+                case Knight: attacks = knightAttacks[square]; break;
+                case Bishop: attacks = getBishopAttacks(square, getOccupancy(All)); break;
+                case Rook:   attacks = getRookAttacks(square, getOccupancy(All)); break;
+                default:     attacks = getQueenAttacks(square, getOccupancy(All)); break;
+                }
+
+                // mobility
+                int mobility = countBits(attacks & mobilityArea) - mobilityCenter[piece];
+                mg[color] += mobility * mgMobility[piece];
+                eg[color] += mobility * egMobility[piece];
+
+                // king safety
+                if (attacks & kingZone) {
+                    attackers++;
+                    attackUnits += kingAttackWeight[piece] * countBits(attacks & kingZone);
+                }
+                clearBit(bitboard, static_cast<Square>(square));
+            }
+        }
+
+        // a lone attacker is rarely dangerous, and without a queen the attack mostly fizzles
+        if (attackers >= 2 && getPieces(color, Queen)) {
+            mg[enemy] -= kingSafetyTable[attackUnits < 63 ? attackUnits : 63];
+        }
+    }
+
+    // pawn structure and king shelter
+    const PawnEntry& pawns = probePawnTable(pawnKey, typeBitboards, colorBitboards);
+    mg[White] += pawns.mg + pawns.shelter[White];
+    eg[White] += pawns.eg;
+    mg[Black] += pawns.shelter[Black];
+
+    // passed pawns blocked by a piece lose half of their endgame bonus
+    for (int color = White; color <= Black; color++) {
+        Bitboard passed = pawns.passed[color];
+        while (passed) {
+            int square = getLSBIndex(passed);
+            int stop = color == White ? square + 8 : square - 8;
+            int relativeRank = color == White ? square / 8 : 7 - square / 8;
+            if (getOccupancy(All) & (1ULL << stop))
+                eg[color] -= egPassed[relativeRank] / 2;
+            clearBit(passed, static_cast<Square>(square));
+        }
+    }
+
+    // blend middlegame and endgame scores by the remaining material
+    int phase = gamePhase < MAX_GAME_PHASE ? gamePhase : MAX_GAME_PHASE;
+    int mgEval = mg[White] - mg[Black];
+    int egEval = eg[White] - eg[Black];
+    int eval = (mgEval * phase + egEval * (MAX_GAME_PHASE - phase)) / MAX_GAME_PHASE;
+
+    return side == White ? eval : -eval;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <array>
+
+#include "chess.h"
+
+// game phase contribution per piece type, 24 = full middlegame material
+extern const int gamePhaseInc[6];
+constexpr int MAX_GAME_PHASE = 24;
+
+// material + piece-square values [color][piece][square], a1 = 0 for both colors
+using PieceSquareTable = std::array<std::array<std::array<int, 64>, 6>, 2>;
+
+extern const PieceSquareTable mgPieceSquare;
+extern const PieceSquareTable egPieceSquare;
+
+// per-thread pawn structure cache
+constexpr int PAWN_TABLE_SIZE = 1 << 13;
+
+struct PawnEntry {
+    uint64_t key;
+    Bitboard passed[2];     // passed pawns [color]
+    int mg;                 // pawn structure score, white's point of view
+    int eg;
+    int kingSquare[2];      // king squares the shelter was computed for
+    int shelter[2];         // middlegame king shelter [color]
+};
+
+struct PawnTableStats {
+    uint64_t probes;
+    uint64_t hits;
+};
+
+// counters of the calling thread's pawn table
+PawnTableStats pawnTableStats();
+void clearPawnTable();
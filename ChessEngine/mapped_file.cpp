@@ -0,0 +1,72 @@
+#include "mapped_file.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string& path, bool sequential) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    DWORD high;
+    DWORD low = GetFileSize(file, &high);
+    mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, high, low, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+        return false;
+
+    void* base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!base) {
+        CloseHandle(mapping);
+        mapping = nullptr;
+        return false;
+    }
+    data = static_cast<const uint8_t*>(base);
+    size = (uint64_t(high) << 32) | low;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data) {
+        UnmapViewOfFile(data);
+        CloseHandle(mapping);
+    }
+    data = nullptr;
+    mapping = nullptr;
+}
+#else
+bool MappedFile::open(const std::string& path, bool sequential) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+        return false;
+
+    madvise(base, st.st_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+
+    data = static_cast<const uint8_t*>(base);
+    size = st.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data)
+        munmap(const_cast<uint8_t*>(data), size);
+    data = nullptr;
+}
+#endif
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+// read-only shared mapping of a whole file, pages are loaded by the OS on first
+// access and shared between every process mapping the same file
+struct MappedFile {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE mapping = nullptr;
+#endif
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    // lookups in tables and books touch a few scattered pages, so read-ahead is disabled
+    // unless the file is read front to back (sequential)
+    bool open(const std::string& path, bool sequential = false);
+    void close();
+};
@@ -0,0 +1,234 @@
+#include "mcts.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "nnue.h"
+
+MCTS::MCTS(const MCTSConfig& config)
+    : config(config), rng(config.seed) {
+    this->config.batchSize = std::max(config.batchSize, 1);
+    Board board;
+    board.parseFEN(START_FEN);
+    setRoot(board);
+}
+
+void MCTS::setRoot(const Board& board) {
+    root = Board(board, false);
+    nodes.clear();
+    nodes.push_back(Node{ 0, 1.0f, 0, 0, UNEXPANDED, 0, 0, 0.0f, 0.0f });
+}
+
+void MCTS::search(int simulations, const MCTSEvaluator& evaluate) {
+    std::vector<Leaf> leaves(config.batchSize);
+    std::vector<Board*> boards;
+    std::vector<float> policy, value;
+
+    int done = 0;
+    while (done < simulations) {
+        // walk down until batchSize leaves wait for the network; a walk that ends on a
+        // leaf already waiting means the tree is too small for more, evaluate what we have
+        int count = 0;
+        for (int attempt = 0; attempt < 2 * config.batchSize && count < config.batchSize
+            && done + count < simulations; attempt++) {
+            Leaf& leaf = leaves[count];
+            descend(leaf);
+            Node& node = nodes[leaf.path.back()];
+            if (node.state == TERMINAL) {
+                backup(leaf.path, node.terminalValue);
+                done++;
+            }
+            else if (node.state == PENDING) {
+                revert(leaf.path);
+                break;
+            }
+            else {
+                node.state = PENDING;
+                count++;
+            }
+        }
+        if (!count)
+            continue;
+
+        boards.resize(count);
+        for (int i = 0; i < count; i++)
+            boards[i] = &leaves[i].board;
+        policy.assign(static_cast<size_t>(count) * POLICY_SIZE, 0.0f);
+        value.assign(count, 0.0f);
+        try {
+            evaluate(boards, policy.data(), value.data());
+        }
+        catch (...) {
+            setRoot(root);
+            throw;
+        }
+
+        for (int i = 0; i < count; i++) {
+            expand(leaves[i].path.back(), leaves[i].legal, policy.data() + static_cast<size_t>(i) * POLICY_SIZE);
+            backup(leaves[i].path, std::clamp(value[i], -1.0f, 1.0f));
+        }
+        done += count;
+    }
+}
+
+// PUCT with virtual loss: simulations in flight count as losses of the child
+uint32_t MCTS::select(uint32_t parent) const {
+    const Node& p = nodes[parent];
+    float sqrtVisits = std::sqrt(static_cast<float>(std::max(p.visits + p.inFlight, 1)));
+    float fpu = (p.visits ? -p.valueSum / p.visits : 0.0f) - config.fpuReduction;
+
+    uint32_t best = p.firstChild;
+    float bestScore = -1e30f;
+    for (uint32_t i = p.firstChild; i < p.firstChild + p.childCount; i++) {
+        const Node& child = nodes[i];
+        float visits = child.visits + config.virtualLoss * child.inFlight;
+        float q = visits > 0 ? (child.valueSum - config.virtualLoss * child.inFlight) / visits : fpu;
+        float score = q + config.cpuct * child.prior * sqrtVisits / (1.0f + visits);
+        if (score > bestScore) {
+            bestScore = score;
+            best = i;
+        }
+    }
+    return best;
+}
+
+// follow the tree to an unexpanded or terminal node, finished games are recognised the
+// first time they are reached (rule draws only below the root, the game may go on there)
+void MCTS::descend(Leaf& leaf) {
+    leaf.board = root;
+    leaf.path.clear();
+    leaf.path.push_back(0);
+    nodes[0].inFlight++;
+
+    uint32_t index = 0;
+    while (nodes[index].state == EXPANDED) {
+        index = select(index);
+        leaf.board.makeMove(nodes[index].move, ALL_MOVES);
+        leaf.path.push_back(index);
+        nodes[index].inFlight++;
+    }
+
+    Node& node = nodes[index];
+    if (node.state != UNEXPANDED)
+        return;
+
+    // below the root any draw ends the line, a single repetition included
+    GameStatus status = leaf.board.status();
+    if (status == CHECKMATE || status == STALEMATE) {
+        node.state = TERMINAL;
+        node.terminalValue = status == CHECKMATE ? -1.0f : 0.0f;
+    }
+    else if (index && (status != ONGOING || leaf.board.isRepetition())) {
+        node.state = TERMINAL;
+        node.terminalValue = 0.0f;
+    }
+    else {
+        leaf.legal = leaf.board.legalMoves();
+    }
+}
+
+// children get the softmax of their logits as priors
+void MCTS::expand(uint32_t index, const MoveList& legal, const float* logits) {
+    float maxLogit = -1e30f;
+    for (size_t i = 0; i < legal.size(); i++)
+        maxLogit = std::max(maxLogit, logits[moveToIndex(legal[i])]);
+
+    uint32_t first = static_cast<uint32_t>(nodes.size());
+    float sum = 0.0f;
+    for (size_t i = 0; i < legal.size(); i++) {
+        float prior = std::exp(logits[moveToIndex(legal[i])] - maxLogit);
+        nodes.push_back(Node{ legal[i], prior, 0, 0, UNEXPANDED, 0, 0, 0.0f, 0.0f });
+        sum += prior;
+    }
+    for (uint32_t i = first; i < nodes.size(); i++)
+        nodes[i].prior /= sum;
+
+    Node& node = nodes[index];
+    node.firstChild = first;
+    node.childCount = static_cast<uint16_t>(legal.size());
+    node.state = EXPANDED;
+
+    if (index == 0 && config.dirichletEpsilon > 0.0f)
+        addNoise(index);
+}
+
+// value for the side to move at the leaf, every node up the path sees it from its mover
+void MCTS::backup(const std::vector<uint32_t>& path, float value) {
+    float v = -value;
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        Node& node = nodes[*it];
+        node.visits++;
+        node.inFlight--;
+        node.valueSum += v;
+        v = -v;
+    }
+}
+
+void MCTS::revert(const std::vector<uint32_t>& path) {
+    for (uint32_t index : path)
+        nodes[index].inFlight--;
+}
+
+void MCTS::addNoise(uint32_t index) {
+    Node& node = nodes[index];
+    std::gamma_distribution<float> gamma(config.dirichletAlpha, 1.0f);
+    std::vector<float> noise(node.childCount);
+    float sum = 0.0f;
+    for (float& n : noise)
+        sum += n = gamma(rng);
+    if (sum <= 0.0f)
+        return;
+    for (uint16_t i = 0; i < node.childCount; i++) {
+        Node& child = nodes[node.firstChild + i];
+        child.prior = (1.0f - config.dirichletEpsilon) * child.prior + config.dirichletEpsilon * noise[i] / sum;
+    }
+}
+
+std::vector<MCTSChild> MCTS::rootChildren() const {
+    std::vector<MCTSChild> children;
+    const Node& node = nodes[0];
+    for (uint32_t i = node.firstChild; i < node.firstChild + node.childCount; i++) {
+        const Node& child = nodes[i];
+        children.push_back({ child.move, child.prior, child.visits, child.visits ? child.valueSum / child.visits : 0.0f });
+    }
+    return children;
+}
+
+Move MCTS::bestMove() const {
+    Move best = 0;
+    int bestVisits = -1;
+    for (const MCTSChild& child : rootChildren())
+        if (child.visits > bestVisits) {
+            bestVisits = child.visits;
+            best = child.move;
+        }
+    return best;
+}
+
+void MCTS::visitPolicy(float* out) const {
+    std::fill_n(out, POLICY_SIZE, 0.0f);
+    std::vector<MCTSChild> children = rootChildren();
+    int total = 0;
+    for (const MCTSChild& child : children)
+        total += child.visits;
+    if (!total)
+        return;
+    for (const MCTSChild& child : children)
+        out[moveToIndex(child.move)] = static_cast<float>(child.visits) / total;
+}
+
+float MCTS::rootValue() const {
+    return nodes[0].visits ? -nodes[0].valueSum / nodes[0].visits : 0.0f;
+}
+
+int MCTS::rootVisits() const {
+    return nodes[0].visits;
+}
+
+void MCTS::nativeEvaluate(const std::vector<Board*>& leaves, float* policy, float* value) {
+    for (size_t i = 0; i < leaves.size(); i++) {
+        int score = nnueIsLoaded() ? leaves[i]->evaluateNNUE() : leaves[i]->evaluate();
+        value[i] = std::tanh(score / 400.0f);
+        std::fill_n(policy + i * POLICY_SIZE, POLICY_SIZE, 0.0f);
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "chess.h"
+#include "policy.h"
+
+// AlphaZero-style Monte Carlo tree search: nodes live in one arena with the children of
+// a node stored next to each other, and leaves are collected batchSize at a time under
+// virtual loss so the network evaluates them in one call
+
+struct MCTSConfig {
+    float cpuct = 1.5f;
+    int batchSize = 16;            // leaves per evaluator call
+    float virtualLoss = 1.0f;      // losses counted for every simulation still in flight
+    float fpuReduction = 0.25f;    // unvisited children score the parent's value minus this
+    float dirichletAlpha = 0.3f;   // root noise, off while dirichletEpsilon is 0
+    float dirichletEpsilon = 0.0f;
+    uint64_t seed = 0;
+};
+
+// fills policy[count][POLICY_SIZE] with logits over the policy indices (only the legal
+// moves are read) and value[count] in [-1, 1] for the side to move of every leaf
+using MCTSEvaluator = std::function<void(const std::vector<Board*>& leaves, float* policy, float* value)>;
+
+// statistics of one root move
+struct MCTSChild {
+    Move move;
+    float prior;
+    int visits;
+    float q;         // mean value for the side to move at the root
+};
+
+class MCTS {
+public:
+    explicit MCTS(const MCTSConfig& config = MCTSConfig());
+
+    // drops the tree
+    void setRoot(const Board& board);
+
+    // adds `simulations` playouts to the tree; playouts ending on a finished game need no
+    // evaluation. If the evaluator throws the tree is dropped and the exception passes on
+    void search(int simulations, const MCTSEvaluator& evaluate);
+
+    std::vector<MCTSChild> rootChildren() const;
+    Move bestMove() const;                       // most visited, 0 without children
+    void visitPolicy(float* out) const;          // root visit shares over POLICY_SIZE
+    float rootValue() const;                     // mean value for the side to move at the root
+    int rootVisits() const;
+    size_t size() const { return nodes.size(); }
+
+    // value from the static or NNUE evaluation and a flat policy, for testing without a network
+    static void nativeEvaluate(const std::vector<Board*>& leaves, float* policy, float* value);
+
+private:
+    enum NodeState : uint8_t { UNEXPANDED, PENDING, EXPANDED, TERMINAL };
+
+    // values are kept from the point of view of the side that played `move`
+    struct Node {
+        Move move;
+        float prior;
+        uint32_t firstChild;
+        uint16_t childCount;
+        NodeState state;
+        int visits;
+        int inFlight;
+        float valueSum;
+        float terminalValue;   // for the side to move, once found TERMINAL
+    };
+
+    // one simulation from the root down to the node it stopped at
+    struct Leaf {
+        std::vector<uint32_t> path;
+        Board board;
+        MoveList legal;
+    };
+
+    MCTSConfig config;
+    Board root;
+    std::vector<Node> nodes;
+    std::mt19937_64 rng;
+
+    uint32_t select(uint32_t parent) const;
+    void descend(Leaf& leaf);
+    void expand(uint32_t index, const MoveList& legal, const float* logits);
+    void backup(const std::vector<uint32_t>& path, float value);
+    void revert(const std::vector<uint32_t>& path);
+    void addNoise(uint32_t index);
+};
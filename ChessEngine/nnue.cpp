@@ -0,0 +1,398 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "chess.h"
+#include "nnue.h"
+#include "logger.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define NNUE_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// kernels are compiled for their instruction set and picked at runtime,
+// so the rest of the engine can be built for baseline x86-64
+#if defined(__GNUC__) || defined(__clang__)
+#define NNUE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define NNUE_TARGET(isa)
+#endif
+
+constexpr int WEIGHT_SCALE_BITS = 6;
+constexpr int OUTPUT_SCALE = 16;
+
+struct alignas(64) NNUEWeights {
+    int16_t ftBias[NNUE_HIDDEN];
+    int16_t ftWeights[NNUE_INPUTS][NNUE_HIDDEN];
+    int32_t l1Bias[NNUE_L1];
+    int8_t l1Weights[NNUE_L1][2 * NNUE_HIDDEN];
+    int32_t l2Bias[NNUE_L2];
+    int8_t l2Weights[NNUE_L2][NNUE_L1];
+    int32_t outBias;
+    int8_t outWeights[NNUE_L2];
+};
+
+// the network in use, swapped atomically by nnueLoad. A search on another thread may still
+// read the one it replaced, so loaded networks stay allocated until exit
+static std::atomic<const NNUEWeights*> current{ nullptr };
+static std::vector<std::unique_ptr<NNUEWeights>> networks;
+static std::mutex loadMutex;
+
+// scalar kernels //
+static void addRowScalar(int16_t* acc, const int16_t* row) {
+    for (int i = 0; i < NNUE_HIDDEN; i++)
+        acc[i] += row[i];
+}
+
+static void subRowScalar(int16_t* acc, const int16_t* row) {
+    for (int i = 0; i < NNUE_HIDDEN; i++)
+        acc[i] -= row[i];
+}
+
+static void affineScalar(const uint8_t* input, int inDims, const int8_t* w, const int32_t* bias, int32_t* output, int outDims) {
+    for (int i = 0; i < outDims; i++) {
+        int32_t sum = bias[i];
+        for (int j = 0; j < inDims; j++)
+            sum += input[j] * w[i * inDims + j];
+        output[i] = sum;
+    }
+}
+
+#if defined(NNUE_X86)
+// AVX2 kernels //
+NNUE_TARGET("avx2")
+static void addRowAVX2(int16_t* acc, const int16_t* row) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i r = _mm256_load_si256(reinterpret_cast<const __m256i*>(row + i));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_add_epi16(a, r));
+    }
+}
+
+NNUE_TARGET("avx2")
+static void subRowAVX2(int16_t* acc, const int16_t* row) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i r = _mm256_load_si256(reinterpret_cast<const __m256i*>(row + i));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_sub_epi16(a, r));
+    }
+}
+
+NNUE_TARGET("avx2")
+static inline int32_t horizontalSumAVX2(__m256i sum) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+// inputs are clipped to [0, 127] so the pairwise int16 sums of maddubs cannot saturate
+NNUE_TARGET("avx2")
+static void affineAVX2(const uint8_t* input, int inDims, const int8_t* w, const int32_t* bias, int32_t* output, int outDims) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (int i = 0; i < outDims; i++) {
+        const int8_t* row = w + i * inDims;
+        __m256i sum = _mm256_setzero_si256();
+        for (int j = 0; j < inDims; j += 32) {
+            __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + j));
+            __m256i wt = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + j));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(in, wt), ones));
+        }
+        output[i] = bias[i] + horizontalSumAVX2(sum);
+    }
+}
+
+// AVX-512 kernels //
+NNUE_TARGET("avx512f,avx512bw")
+static void addRowAVX512(int16_t* acc, const int16_t* row) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 32) {
+        __m512i a = _mm512_load_si512(acc + i);
+        __m512i r = _mm512_load_si512(row + i);
+        _mm512_store_si512(acc + i, _mm512_add_epi16(a, r));
+    }
+}
+
+NNUE_TARGET("avx512f,avx512bw")
+static void subRowAVX512(int16_t* acc, const int16_t* row) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 32) {
+        __m512i a = _mm512_load_si512(acc + i);
+        __m512i r = _mm512_load_si512(row + i);
+        _mm512_store_si512(acc + i, _mm512_sub_epi16(a, r));
+    }
+}
+
+NNUE_TARGET("avx512f,avx512bw")
+static void affineAVX512(const uint8_t* input, int inDims, const int8_t* w, const int32_t* bias, int32_t* output, int outDims) {
+    const __m512i ones = _mm512_set1_epi16(1);
+    const __m256i ones256 = _mm256_set1_epi16(1);
+    for (int i = 0; i < outDims; i++) {
+        const int8_t* row = w + i * inDims;
+        __m512i sum = _mm512_setzero_si512();
+        int j = 0;
+        for (; j + 64 <= inDims; j += 64) {
+            __m512i in = _mm512_loadu_si512(input + j);
+            __m512i wt = _mm512_loadu_si512(row + j);
+            sum = _mm512_add_epi32(sum, _mm512_madd_epi16(_mm512_maddubs_epi16(in, wt), ones));
+        }
+        // halves added by hand, GCC's _mm512_reduce_add_epi32 and plain extract leave the
+        // masked-off lanes undefined and warn maybe-uninitialized, the zero-masking form does not
+        __m256i half = _mm256_add_epi32(_mm512_maskz_extracti64x4_epi64(0xFF, sum, 0),
+            _mm512_maskz_extracti64x4_epi64(0xFF, sum, 1));
+        int32_t total = horizontalSumAVX2(half);
+        // 32 wide tail for the small hidden layers
+        if (j < inDims) {
+            __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + j));
+            __m256i wt = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + j));
+            total += horizontalSumAVX2(_mm256_madd_epi16(_mm256_maddubs_epi16(in, wt), ones256));
+        }
+        output[i] = bias[i] + total;
+    }
+}
+#endif
+
+enum SimdLevel { SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512 };
+
+static SimdLevel detectSimd() {
+#if defined(NNUE_X86)
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return SIMD_SCALAR;
+
+    // the OS has to save the wide registers as well
+    __cpuid(info, 1);
+    if (!(info[2] & (1 << 27)))
+        return SIMD_SCALAR;
+    unsigned long long xcr0 = _xgetbv(0);
+
+    __cpuidex(info, 7, 0);
+    if ((info[1] & (1 << 16)) && (info[1] & (1 << 30)) && (xcr0 & 0xe6) == 0xe6)
+        return SIMD_AVX512;
+    if ((info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6)
+        return SIMD_AVX2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return SIMD_AVX2;
+#endif
+#endif
+    return SIMD_SCALAR;
+}
+
+struct NNUEKernels {
+    SimdLevel level;
+    void (*addRow)(int16_t* acc, const int16_t* row);
+    void (*subRow)(int16_t* acc, const int16_t* row);
+    void (*affine)(const uint8_t* input, int inDims, const int8_t* w, const int32_t* bias, int32_t* output, int outDims);
+};
+
+static const NNUEKernels kernels = [] {
+    switch (detectSimd()) {
+#if defined(NNUE_X86)
+    case SIMD_AVX512: return NNUEKernels{ SIMD_AVX512, addRowAVX512, subRowAVX512, affineAVX512 };
+    case SIMD_AVX2:   return NNUEKernels{ SIMD_AVX2, addRowAVX2, subRowAVX2, affineAVX2 };
+#endif
+    default:          return NNUEKernels{ SIMD_SCALAR, addRowScalar, subRowScalar, affineScalar };
+    }
+    }();
+
+const char* nnueSimdLevel() {
+    switch (kernels.level) {
+    case SIMD_AVX512: return "avx512";
+    case SIMD_AVX2:   return "avx2";
+    default:          return "scalar";
+    }
+}
+
+bool nnueLoad(const std::string& path) {
+
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        logger.error("could not open network file: " + path);
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version, dims[4];
+    bool ok = fread(magic, 1, 4, file) == 4 && memcmp(magic, "CENN", 4) == 0
+        && fread(&version, 4, 1, file) == 1 && version == 1
+        && fread(dims, 4, 4, file) == 4
+        && dims[0] == NNUE_INPUTS && dims[1] == NNUE_HIDDEN && dims[2] == NNUE_L1 && dims[3] == NNUE_L2;
+
+    if (!ok) {
+        fclose(file);
+        logger.error("unsupported network header: " + path);
+        return false;
+    }
+
+    auto loaded = std::make_unique<NNUEWeights>();
+    ok = fread(loaded->ftBias, sizeof(loaded->ftBias), 1, file) == 1
+        && fread(loaded->ftWeights, sizeof(loaded->ftWeights), 1, file) == 1
+        && fread(loaded->l1Bias, sizeof(loaded->l1Bias), 1, file) == 1
+        && fread(loaded->l1Weights, sizeof(loaded->l1Weights), 1, file) == 1
+        && fread(loaded->l2Bias, sizeof(loaded->l2Bias), 1, file) == 1
+        && fread(loaded->l2Weights, sizeof(loaded->l2Weights), 1, file) == 1
+        && fread(&loaded->outBias, sizeof(loaded->outBias), 1, file) == 1
+        && fread(loaded->outWeights, sizeof(loaded->outWeights), 1, file) == 1;
+    fclose(file);
+
+    if (!ok) {
+        logger.error("truncated network file: " + path);
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(loadMutex);
+        networks.push_back(std::move(loaded));
+        current.store(networks.back().get(), std::memory_order_release);
+    }
+    logger.info("loaded network " + path + " (" + nnueSimdLevel() + ")");
+    return true;
+}
+
+bool nnueIsLoaded() {
+    return current.load(std::memory_order_acquire) != nullptr;
+}
+
+int nnueFeatureIndex(int perspective, int kingSquare, int color, int piece, int square) {
+    // mirror ranks so both perspectives see their own pieces moving up the board
+    int orient = perspective == White ? 0 : 56;
+    int pieceIndex = piece * 2 + (color != perspective);
+    return (kingSquare ^ orient) * 640 + pieceIndex * 64 + (square ^ orient);
+}
+
+void nnueRefresh(NNUEEntry& entry, int perspective, const uint64_t types[6], const uint64_t colors[2]) {
+
+    const NNUEWeights* weights = current.load(std::memory_order_acquire);
+    int16_t* acc = entry.accumulation[perspective];
+    memcpy(acc, weights->ftBias, sizeof(weights->ftBias));
+
+    int kingSquare = getLSBIndex(types[King] & colors[perspective]);
+
+    for (int color = White; color <= Black; color++) {
+        for (int piece = Pawn; piece <= Queen; piece++) {
+            Bitboard bitboard = types[piece] & colors[color];
+            while (bitboard) {
+                int square = getLSBIndex(bitboard);
+                kernels.addRow(acc, weights->ftWeights[nnueFeatureIndex(perspective, kingSquare, color, piece, square)]);
+                clearBit(bitboard, static_cast<Square>(square));
+            }
+        }
+    }
+    entry.computed[perspective] = true;
+}
+
+void nnueUpdate(NNUEEntry& entry, const NNUEEntry& parent, int perspective, int kingSquare) {
+
+    const NNUEWeights* weights = current.load(std::memory_order_acquire);
+    int16_t* acc = entry.accumulation[perspective];
+    memcpy(acc, parent.accumulation[perspective], sizeof(entry.accumulation[perspective]));
+
+    const NNUEDirtyPiece& dirty = entry.dirty;
+    for (int i = 0; i < dirty.count; i++) {
+        // kings are not input features, only their square is
+        if (dirty.piece[i] == King)
+            continue;
+
+        int index = nnueFeatureIndex(perspective, kingSquare, dirty.color[i], dirty.piece[i], dirty.square[i]);
+        if (dirty.sign[i] > 0)
+            kernels.addRow(acc, weights->ftWeights[index]);
+        else
+            kernels.subRow(acc, weights->ftWeights[index]);
+    }
+    entry.computed[perspective] = true;
+}
+
+// int16 -> uint8 clamped to [0, 127]
+static void clippedReLU(const int16_t* input, uint8_t* output, int dims) {
+#if defined(NNUE_X86)
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < dims; i += 16) {
+        __m128i lo = _mm_max_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(input + i)), zero);
+        __m128i hi = _mm_max_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(input + i + 8)), zero);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packs_epi16(lo, hi));
+    }
+#else
+    for (int i = 0; i < dims; i++)
+        output[i] = static_cast<uint8_t>(input[i] < 0 ? 0 : input[i] > 127 ? 127 : input[i]);
+#endif
+}
+
+// int32 -> uint8 scaled and clamped to [0, 127]
+static void scaledReLU(const int32_t* input, uint8_t* output, int dims) {
+    for (int i = 0; i < dims; i++) {
+        int32_t v = input[i] >> WEIGHT_SCALE_BITS;
+        output[i] = static_cast<uint8_t>(v < 0 ? 0 : v > 127 ? 127 : v);
+    }
+}
+
+int nnueOutput(const NNUEEntry& entry, int side) {
+
+    const NNUEWeights* weights = current.load(std::memory_order_acquire);
+    alignas(64) uint8_t transformed[2 * NNUE_HIDDEN];
+    alignas(64) int32_t l1Out[NNUE_L1];
+    alignas(64) uint8_t l1Act[NNUE_L1];
+    alignas(64) int32_t l2Out[NNUE_L2];
+    alignas(64) uint8_t l2Act[NNUE_L2];
+    int32_t out;
+
+    // side to move first
+    clippedReLU(entry.accumulation[side], transformed, NNUE_HIDDEN);
+    clippedReLU(entry.accumulation[!side], transformed + NNUE_HIDDEN, NNUE_HIDDEN);
+
+    kernels.affine(transformed, 2 * NNUE_HIDDEN, &weights->l1Weights[0][0], weights->l1Bias, l1Out, NNUE_L1);
+    scaledReLU(l1Out, l1Act, NNUE_L1);
+
+    kernels.affine(l1Act, NNUE_L1, &weights->l2Weights[0][0], weights->l2Bias, l2Out, NNUE_L2);
+    scaledReLU(l2Out, l2Act, NNUE_L2);
+
+    affineScalar(l2Act, NNUE_L2, weights->outWeights, &weights->outBias, &out, 1);
+
+    return out / OUTPUT_SCALE;
+}
+
+// lazily bring the accumulator of the current ply up to date and evaluate
+int Board::evaluateNNUE() {
+
+    if (!nnueIsLoaded())
+        return evaluate();
+
+    // fresh entries are all stale, so the current ply (a copy may start above 0) refreshes
+    if (nnueStack.empty())
+        nnueStack.resize(NNUE_MAX_PLY);
+
+    NNUEEntry& entry = nnueStack[nnuePly];
+
+    for (int perspective = White; perspective <= Black; perspective++) {
+        if (entry.computed[perspective])
+            continue;
+
+        // walk back to the closest computed accumulator that no king move separates us from
+        int ply = nnuePly;
+        while (ply > 0 && !nnueStack[ply].refresh[perspective] && !nnueStack[ply - 1].computed[perspective])
+            ply--;
+
+        if (ply == 0 || nnueStack[ply].refresh[perspective]) {
+            nnueRefresh(entry, perspective, typeBitboards, colorBitboards);
+            continue;
+        }
+
+        int kingSquare = getLSBIndex(getPieces(perspective, King));
+        for (; ply <= nnuePly; ply++)
+            nnueUpdate(nnueStack[ply], nnueStack[ply - 1], perspective, kingSquare);
+    }
+
+    return nnueOutput(entry, side);
+}
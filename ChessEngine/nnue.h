@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// HalfKP network: (40960 -> 256) x 2 perspectives -> 32 -> 32 -> 1
+constexpr int NNUE_INPUTS = 64 * 640;   // king square x (10 non-king pieces x 64 squares)
+constexpr int NNUE_HIDDEN = 256;        // feature transformer outputs per perspective
+constexpr int NNUE_L1 = 32;
+constexpr int NNUE_L2 = 32;
+
+// accumulator stack depth, enough for a full search line
+constexpr int NNUE_MAX_PLY = 256;
+
+// weights file layout (little endian):
+//
+//   char     magic[4]       "CENN"
+//   uint32   version        1
+//   uint32   dims[4]        NNUE_INPUTS, NNUE_HIDDEN, NNUE_L1, NNUE_L2
+//   int16    ftBias[NNUE_HIDDEN]
+//   int16    ftWeights[NNUE_INPUTS][NNUE_HIDDEN]
+//   int32    l1Bias[NNUE_L1]
+//   int8     l1Weights[NNUE_L1][2 * NNUE_HIDDEN]
+//   int32    l2Bias[NNUE_L2]
+//   int8     l2Weights[NNUE_L2][NNUE_L1]
+//   int32    outBias
+//   int8     outWeights[NNUE_L2]
+//
+// feature transformer outputs and hidden activations are clipped to [0, 127],
+// hidden layers are scaled down by 64 and the output by 16 to give centipawns
+
+// pieces added / removed by a single move, replayed onto the parent accumulator
+struct NNUEDirtyPiece {
+    int count;
+    int color[4];
+    int piece[4];
+    int square[4];
+    int sign[4];   // +1 added, -1 removed
+};
+
+struct NNUEEntry {
+    alignas(64) int16_t accumulation[2][NNUE_HIDDEN];   // [perspective][neuron]
+    bool computed[2];
+    bool refresh[2];   // perspective king moved, incremental update not possible
+    NNUEDirtyPiece dirty;
+};
+
+// the new network is used from the next evaluation on; accumulators computed with the old
+// one are not refreshed, so a search should not be running meanwhile
+bool nnueLoad(const std::string& path);
+bool nnueIsLoaded();
+const char* nnueSimdLevel();
+
+// feature index of a piece for one perspective
+int nnueFeatureIndex(int perspective, int kingSquare, int color, int piece, int square);
+
+// full refresh of one perspective from the piece type [piece] and color [color] bitboards
+void nnueRefresh(NNUEEntry& entry, int perspective, const uint64_t types[6], const uint64_t colors[2]);
+
+// copy the parent accumulator and apply the dirty pieces of this entry
+void nnueUpdate(NNUEEntry& entry, const NNUEEntry& parent, int perspective, int kingSquare);
+
+// run the hidden layers on a computed accumulator
+int nnueOutput(const NNUEEntry& entry, int side);
@@ -0,0 +1,149 @@
+#include <algorithm>
+
+#include "packed.h"
+
+PackedPosition packPosition(const Board& board, int score, Move move, int result) {
+    PackedPosition packed = {};
+    packed.occupancy = board.getOccupancy(All);
+
+    uint8_t codes[64];
+    for (int color = White; color <= Black; color++)
+        for (int piece = Pawn; piece <= King; piece++)
+            for (Bitboard bitboard = board.getPieces(color, piece); bitboard; bitboard &= bitboard - 1)
+                codes[getLSBIndex(bitboard)] = static_cast<uint8_t>(6 * color + piece);
+
+    // the pawn that just double pushed stands in front of the en passant square
+    int side = board.getSide();
+    int enpassant = board.getEnpassant();
+    if (enpassant != no_sq)
+        codes[side == White ? enpassant - 8 : enpassant + 8] = PACKED_ENPASSANT_PAWN;
+
+    int castling = board.getCastling();
+    Bitboard whiteRooks = board.getPieces(White, Rook), blackRooks = board.getPieces(Black, Rook);
+    if ((castling & wq) && getBit(whiteRooks, a1)) codes[a1] = PACKED_WHITE_CASTLE_ROOK;
+    if ((castling & wk) && getBit(whiteRooks, h1)) codes[h1] = PACKED_WHITE_CASTLE_ROOK;
+    if ((castling & bq) && getBit(blackRooks, a8)) codes[a8] = PACKED_BLACK_CASTLE_ROOK;
+    if ((castling & bk) && getBit(blackRooks, h8)) codes[h8] = PACKED_BLACK_CASTLE_ROOK;
+    if (side == Black)
+        codes[getLSBIndex(board.getPieces(Black, King))] = PACKED_BLACK_KING_TO_MOVE;
+
+    Bitboard occupancy = packed.occupancy;
+    for (int n = 0; occupancy; n++, occupancy &= occupancy - 1)
+        packed.pieces[n / 2] |= codes[getLSBIndex(occupancy)] << (4 * (n & 1));
+
+    packed.halfmove = static_cast<uint8_t>(std::min(board.getHalfmoveClock(), 255));
+    packed.fullmove = static_cast<uint16_t>(std::min(board.getFullmoveNumber(), 65535));
+    packed.score = static_cast<int16_t>(std::clamp(score, -32767, 32767));
+    packed.move = packMove(move);
+    packed.result = static_cast<int8_t>(std::clamp(result, -1, 1));
+    return packed;
+}
+
+FENError unpackPosition(const PackedPosition& packed, Board& board) {
+    Bitboard occupancy = packed.occupancy;
+    if (countBits(occupancy) > 32)
+        return FEN_BAD_PLACEMENT;
+
+    Bitboard pieces[2][6] = {};
+    int side = White, castling = 0, enpassant = no_sq;
+    for (int n = 0; occupancy; n++, occupancy &= occupancy - 1) {
+        Square square = static_cast<Square>(getLSBIndex(occupancy));
+        int code = (packed.pieces[n / 2] >> (4 * (n & 1))) & 15;
+
+        switch (code) {
+        case PACKED_ENPASSANT_PAWN:
+            // a white pawn on the fourth rank or a black one on the fifth
+            if (enpassant != no_sq || (square / 8 != 3 && square / 8 != 4))
+                return FEN_BAD_ENPASSANT;
+            setBit(pieces[square / 8 == 3 ? White : Black][Pawn], square);
+            enpassant = square / 8 == 3 ? square - 8 : square + 8;
+            break;
+        case PACKED_WHITE_CASTLE_ROOK:
+            if (square != a1 && square != h1)
+                return FEN_BAD_CASTLING;
+            setBit(pieces[White][Rook], square);
+            castling |= square == a1 ? wq : wk;
+            break;
+        case PACKED_BLACK_CASTLE_ROOK:
+            if (square != a8 && square != h8)
+                return FEN_BAD_CASTLING;
+            setBit(pieces[Black][Rook], square);
+            castling |= square == a8 ? bq : bk;
+            break;
+        case PACKED_BLACK_KING_TO_MOVE:
+            setBit(pieces[Black][King], square);
+            side = Black;
+            break;
+        default:
+            setBit(pieces[code / 6][code % 6], square);
+        }
+    }
+
+    return board.setPosition(pieces, side, castling, enpassant, packed.halfmove, packed.fullmove);
+}
+
+uint16_t packMove(Move move) {
+    if (!move)
+        return 0;
+    MoveStore m(move);
+    uint16_t packed = static_cast<uint16_t>(m.getSource() | m.getTarget() << 6);
+    if (m.getPromoted())
+        packed |= (m.getPromoted() - Knight) << 12 | 1 << 14;
+    return packed;
+}
+
+Move unpackMove(Board& board, uint16_t move) {
+    if (!move)
+        return 0;
+    int promoted = move & (1 << 14) ? Knight + ((move >> 12) & 3) : 0;
+    return board.findMove(move & 63, (move >> 6) & 63, promoted);
+}
+
+bool PackedWriter::open(const std::string& path, bool append) {
+    close();
+    file = fopen(path.c_str(), append ? "ab" : "wb");
+    written = 0;
+    failed = false;
+    return file != nullptr;
+}
+
+bool PackedWriter::write(const PackedPosition& packed) {
+    if (!file || fwrite(&packed, sizeof(packed), 1, file) != 1) {
+        failed = true;
+        return false;
+    }
+    written++;
+    return true;
+}
+
+bool PackedWriter::write(const Board& board, int score, Move move, int result) {
+    return write(packPosition(board, score, move, result));
+}
+
+bool PackedWriter::close() {
+    if (!file)
+        return !failed;
+    if (fclose(file))
+        failed = true;
+    file = nullptr;
+    return !failed;
+}
+
+bool PackedReader::open(const std::string& path) {
+    close();
+    if (!file.open(path))
+        return false;
+    if (file.size % sizeof(PackedPosition)) {
+        file.close();
+        return false;
+    }
+    records = reinterpret_cast<const PackedPosition*>(file.data);
+    count = file.size / sizeof(PackedPosition);
+    return true;
+}
+
+void PackedReader::close() {
+    file.close();
+    records = nullptr;
+    count = 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "chess.h"
+#include "mapped_file.h"
+
+// Fixed-size 32-byte training records, about a third of the size of a FEN line and decoded
+// without any text parsing. Files are plain arrays of records (little-endian), so
+// record i is at byte 32 * i and a dataset is read by mapping the file.
+//
+// pieces holds a 4-bit code per occupied square in square order (a1 first), low
+// nibble first: 0-11 are color * 6 + piece, and the codes below carry the rest of
+// the position the way Stockfish's packed format does
+//   12  pawn that just made a double push (the en passant square is behind it)
+//   13  white rook that can still castle (a1: queen side, h1: king side)
+//   14  black rook that can still castle (a8 / h8)
+//   15  black king with black to move
+struct PackedPosition {
+    uint64_t occupancy;
+    uint8_t pieces[16];
+    uint8_t halfmove;      // capped at 255
+    int8_t result;         // 1 win, 0 draw, -1 loss, side to move's point of view
+    uint16_t fullmove;
+    int16_t score;         // centipawns, side to move's point of view
+    uint16_t move;         // packMove, 0 for none
+};
+
+static_assert(sizeof(PackedPosition) == 32, "packed positions must be 32 bytes");
+
+enum PackedCode : uint8_t {
+    PACKED_ENPASSANT_PAWN = 12,
+    PACKED_WHITE_CASTLE_ROOK = 13,
+    PACKED_BLACK_CASTLE_ROOK = 14,
+    PACKED_BLACK_KING_TO_MOVE = 15
+};
+
+PackedPosition packPosition(const Board& board, int score = 0, Move move = 0, int result = 0);
+
+// the board is left unchanged if the record does not describe a valid position
+FENError unpackPosition(const PackedPosition& packed, Board& board);
+
+// source | target << 6 | (promoted piece - Knight) << 12 | 1 << 14 for promotions
+uint16_t packMove(Move move);
+
+// the legal move of the board a packed move stands for, 0 if there is none
+Move unpackMove(Board& board, uint16_t move);
+
+// appends records to a file, buffered by stdio
+class PackedWriter {
+public:
+    PackedWriter() = default;
+    PackedWriter(const PackedWriter&) = delete;
+    PackedWriter& operator=(const PackedWriter&) = delete;
+    ~PackedWriter() { close(); }
+
+    bool open(const std::string& path, bool append = false);
+    bool isOpen() const { return file != nullptr; }
+    bool write(const PackedPosition& packed);
+    bool write(const Board& board, int score = 0, Move move = 0, int result = 0);
+    // flushes and closes, false if any write failed
+    bool close();
+
+    size_t count() const { return written; }
+
+private:
+    FILE* file = nullptr;
+    size_t written = 0;
+    bool failed = false;
+};
+
+// random access to the records of a packed file through a read-only mapping,
+// safe to read from any number of threads
+class PackedReader {
+public:
+    // false if the file is missing, empty or not a whole number of records
+    bool open(const std::string& path);
+    void close();
+
+    size_t size() const { return count; }
+    const PackedPosition& operator[](size_t i) const { return records[i]; }
+    FENError board(size_t i, Board& board) const { return unpackPosition(records[i], board); }
+
+private:
+    MappedFile file;
+    const PackedPosition* records = nullptr;
+    size_t count = 0;
+};
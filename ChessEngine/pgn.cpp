@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#include "mapped_file.h"
+#include "packed.h"
+#include "pgn.h"
+#include "thread_pool.h"
+
+namespace {
+
+// games split off the file per round, and per pool task
+constexpr size_t PGN_WINDOW = 4096;
+constexpr size_t PGN_GRAIN = 8;
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+PGNResult parseResult(std::string_view token) {
+    if (token == "1-0") return PGN_WHITE_WINS;
+    if (token == "0-1") return PGN_BLACK_WINS;
+    if (token == "1/2-1/2") return PGN_DRAW;
+    return PGN_UNKNOWN;
+}
+
+// a game runs from its first tag line through the termination marker of its movetext,
+// or up to the next tag line when the marker is missing. Comments, which may span
+// lines, and variations are skipped, so neither a "[" line inside a comment nor a
+// result inside a variation ends the game
+std::string_view nextGame(std::string_view text, size_t& pos) {
+    size_t begin = pos;
+    bool movetext = false;
+    bool comment = false;
+    int depth = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        end = end == std::string_view::npos ? text.size() : end + 1;
+
+        size_t first = pos;
+        while (first < end && isSpace(text[first]))
+            first++;
+        if (first == end || (!comment && text[pos] == '%')) {
+            pos = end;
+            continue;
+        }
+        if (!comment && text[first] == '[') {
+            if (movetext)
+                break;
+            pos = end;
+            continue;
+        }
+
+        movetext = true;
+        for (size_t i = first; i < end;) {
+            char c = text[i];
+            if (comment) {
+                comment = c != '}';
+                i++;
+            }
+            else if (c == ';') {
+                break;
+            }
+            else if (isSpace(c) || strchr("{})(", c)) {
+                if (c == '{')
+                    comment = true;
+                else if (c == '(')
+                    depth++;
+                else if (c == ')' && depth > 0)
+                    depth--;
+                i++;
+            }
+            else {
+                size_t start = i;
+                while (i < end && !isSpace(text[i]) && !strchr("{};()", text[i]))
+                    i++;
+                std::string_view token = text.substr(start, i - start);
+                if (depth == 0 && (parseResult(token) != PGN_UNKNOWN || token == "*")) {
+                    pos = i;
+                    return text.substr(begin, pos - begin);
+                }
+            }
+        }
+        pos = end;
+    }
+    return text.substr(begin, pos - begin);
+}
+
+// [Name "value"], returns the position after the closing bracket
+size_t parseTag(std::string_view text, size_t pos, std::string_view& name, std::string_view& value) {
+    size_t begin = ++pos;
+    while (pos < text.size() && !isSpace(text[pos]) && text[pos] != ']')
+        pos++;
+    name = text.substr(begin, pos - begin);
+    value = {};
+
+    size_t quote = text.find('"', pos);
+    size_t close = text.find(']', pos);
+    if (quote < close) {
+        size_t end = quote + 1;
+        while (end < text.size() && text[end] != '"')
+            end += text[end] == '\\' ? 2 : 1;
+        value = text.substr(quote + 1, std::min(end, text.size()) - quote - 1);
+        close = text.find(']', end);
+    }
+    return close == std::string_view::npos ? text.size() : close + 1;
+}
+
+void decodeGame(std::string_view text, PGNGame& game, Board& board) {
+    game.fen.clear();
+    game.moves.clear();
+    game.result = PGN_UNKNOWN;
+    game.complete = true;
+
+    // tag pairs
+    PGNResult tagResult = PGN_UNKNOWN;
+    size_t pos = 0;
+    while (true) {
+        while (pos < text.size() && isSpace(text[pos]))
+            pos++;
+        if (pos >= text.size() || text[pos] != '[')
+            break;
+        std::string_view name, value;
+        pos = parseTag(text, pos, name, value);
+        if (name == "FEN")
+            game.fen = value;
+        else if (name == "Result")
+            tagResult = parseResult(value);
+    }
+
+    // a bad start position still reads through to the result
+    if (board.parseFEN(game.fen.empty() ? START_FEN : game.fen) != FEN_OK)
+        game.complete = false;
+
+    // movetext, a game without a termination marker is truncated
+    PGNResult textResult = PGN_UNKNOWN;
+    bool terminated = false;
+    while (pos < text.size()) {
+        char c = text[pos];
+        if (isSpace(c)) {
+            pos++;
+        }
+        else if (c == '{') {
+            size_t end = text.find('}', pos);
+            pos = end == std::string_view::npos ? text.size() : end + 1;
+        }
+        else if (c == ';' || (c == '%' && (pos == 0 || text[pos - 1] == '\n'))) {
+            size_t end = text.find('\n', pos);
+            pos = end == std::string_view::npos ? text.size() : end + 1;
+        }
+        else if (c == '(') {
+            // variations nest and may hold comments with parentheses
+            int depth = 0;
+            for (; pos < text.size(); pos++) {
+                if (text[pos] == '{') {
+                    size_t end = text.find('}', pos);
+                    pos = end == std::string_view::npos ? text.size() - 1 : end;
+                }
+                else if (text[pos] == '(') {
+                    depth++;
+                }
+                else if (text[pos] == ')' && --depth == 0) {
+                    pos++;
+                    break;
+                }
+            }
+        }
+        else {
+            size_t begin = pos;
+            while (pos < text.size() && !isSpace(text[pos]) && !strchr("{};()", text[pos]))
+                pos++;
+            std::string_view token = text.substr(begin, pos - begin);
+            // stray closing bracket
+            if (token.empty()) {
+                pos++;
+                continue;
+            }
+
+            PGNResult result = parseResult(token);
+            if (result != PGN_UNKNOWN || token == "*") {
+                textResult = result;
+                terminated = true;
+                break;
+            }
+            // NAGs, the old "e.p." mark after an en passant capture, and move numbers
+            // that may be glued to the move ("12.Nf3", "12...Nf6")
+            if (token[0] == '$' || token == "e.p.")
+                continue;
+            size_t start = 0;
+            while (start < token.size() && token[start] >= '0' && token[start] <= '9')
+                start++;
+            if (start < token.size() && token[start] == '.') {
+                while (start < token.size() && token[start] == '.')
+                    start++;
+                token.remove_prefix(start);
+            }
+            if (token.empty() || !game.complete)
+                continue;
+
+            Move move = board.parseSAN(token);
+            if (!move || !board.makeMove(move, ALL_MOVES))
+                game.complete = false;
+            else
+                game.moves.push_back(move);
+        }
+    }
+
+    if (!terminated)
+        game.complete = false;
+    game.result = tagResult != PGN_UNKNOWN ? tagResult : textResult;
+}
+
+// streams the games of a file in windows: decoded(slot, game) runs on the pool threads
+// for every game of the window, then windowDone(count) on the calling thread
+bool forEachWindow(const std::string& path, PGNStats* stats,
+    const std::function<void(size_t, const PGNGame&)>& decoded, const std::function<void(size_t)>& windowDone) {
+    MappedFile file;
+    if (!file.open(path, true))
+        return false;
+    std::string_view text(reinterpret_cast<const char*>(file.data), file.size);
+    // UTF-8 byte order mark
+    size_t pos = text.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+
+    std::shared_ptr<ThreadPool> pool = ThreadPool::global();
+    std::vector<std::string_view> texts(PGN_WINDOW);
+    std::vector<PGNGame> games(PGN_WINDOW);
+    size_t index = 0;
+
+    while (pos < text.size()) {
+        size_t count = 0;
+        while (count < PGN_WINDOW && pos < text.size()) {
+            texts[count] = nextGame(text, pos);
+            // trailing whitespace is not a game
+            if (std::find_if(texts[count].begin(), texts[count].end(), [](char c) { return !isSpace(c); }) != texts[count].end())
+                count++;
+        }
+
+        pool->parallelFor(count, PGN_GRAIN, [&](size_t begin, size_t end) {
+            Board board;
+            for (size_t i = begin; i < end; i++) {
+                games[i].index = index + i;
+                decodeGame(texts[i], games[i], board);
+                decoded(i, games[i]);
+            }
+        });
+
+        if (stats) {
+            for (size_t i = 0; i < count; i++) {
+                stats->moves += games[i].moves.size();
+                stats->errors += !games[i].complete;
+            }
+            stats->games += count;
+        }
+        index += count;
+        if (windowDone)
+            windowDone(count);
+    }
+    return true;
+}
+
+}
+
+bool readPGN(const std::string& path, const PGNCallback& callback, PGNStats* stats) {
+    if (stats)
+        *stats = PGNStats();
+    return forEachWindow(path, stats, [&](size_t, const PGNGame& game) { callback(game); }, nullptr);
+}
+
+bool pgnToPacked(const std::string& pgnPath, const std::string& packedPath, PGNStats* stats) {
+    if (stats)
+        *stats = PGNStats();
+    PackedWriter writer;
+    if (!writer.open(packedPath))
+        return false;
+
+    // records of every game of the window, written in file order
+    std::vector<std::vector<PackedPosition>> records(PGN_WINDOW);
+    bool ok = forEachWindow(pgnPath, stats,
+        [&](size_t slot, const PGNGame& game) {
+            std::vector<PackedPosition>& out = records[slot];
+            out.clear();
+            if (game.result == PGN_UNKNOWN || !game.complete || game.moves.empty())
+                return;
+            Board board;
+            board.parseFEN(game.fen.empty() ? START_FEN : game.fen);
+            for (Move move : game.moves) {
+                int result = board.getSide() == White ? game.result : -game.result;
+                out.push_back(packPosition(board, 0, move, result));
+                board.makeMove(move, ALL_MOVES);
+            }
+        },
+        [&](size_t count) {
+            for (size_t i = 0; i < count; i++)
+                for (const PackedPosition& record : records[i])
+                    writer.write(record);
+        });
+
+    if (stats)
+        stats->records = writer.count();
+    return writer.close() && ok;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "chess.h"
+
+// PGN game databases read straight from a memory-mapped file: games are split off in
+// windows while streaming through the file and decoded on the batch thread pool, SAN
+// moves by Board::parseSAN, which finds the source square from the attack tables and
+// checks it with findMove instead of generating moves. Comments, variations, NAGs,
+// "e.p." marks and move numbers are skipped; only the mainline is kept
+
+enum PGNResult : int8_t {
+    PGN_BLACK_WINS = -1,
+    PGN_DRAW = 0,
+    PGN_WHITE_WINS = 1,
+    PGN_UNKNOWN = 2        // "*" or no result at all
+};
+
+struct PGNGame {
+    size_t index = 0;              // position of the game in the file
+    std::string fen;               // FEN tag, empty for the standard start position
+    std::vector<Move> moves;       // mainline up to the first move that could not be decoded
+    PGNResult result = PGN_UNKNOWN;
+    bool complete = true;          // false after a bad FEN, an illegal / unreadable move or
+                                   // movetext that ends without a result ("1-0", ..., "*")
+};
+
+struct PGNStats {
+    size_t games = 0;
+    size_t moves = 0;              // decoded moves over all games
+    size_t errors = 0;             // games that are not complete
+    size_t records = 0;            // positions written by pgnToPacked
+};
+
+// called on the pool threads, concurrently and with games in any order
+using PGNCallback = std::function<void(const PGNGame& game)>;
+
+// false if the file can not be opened
+bool readPGN(const std::string& path, const PGNCallback& callback, PGNStats* stats = nullptr);
+
+// every position of the decoded mainlines with the move played there and the game
+// result (side to move's point of view) as packed records, in file order; games
+// without a result or that are not complete are skipped
+bool pgnToPacked(const std::string& pgnPath, const std::string& packedPath, PGNStats* stats = nullptr);
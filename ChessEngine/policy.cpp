@@ -0,0 +1,79 @@
+#include "policy.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// (file, rank) steps of the queen directions and knight jumps in plane order
+static const int queenSteps[8][2] = { {0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1} };
+static const int knightSteps[8][2] = { {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2} };
+
+static int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+int moveToIndex(Move move) {
+    MoveStore m(move);
+    int source = m.getSource();
+    int fileStep = (m.getTarget() & 7) - (source & 7);
+    int rankStep = (m.getTarget() >> 3) - (source >> 3);
+    int promoted = m.getPromoted();
+
+    if (promoted && promoted != Queen)
+        return (64 + 3 * (promoted - Knight) + fileStep + 1) * 64 + source;
+
+    if (std::abs(fileStep * rankStep) == 2) {
+        for (int k = 0; k < 8; k++)
+            if (knightSteps[k][0] == fileStep && knightSteps[k][1] == rankStep)
+                return (56 + k) * 64 + source;
+    }
+
+    int distance = std::max(std::abs(fileStep), std::abs(rankStep));
+    for (int k = 0; k < 8; k++)
+        if (queenSteps[k][0] == sign(fileStep) && queenSteps[k][1] == sign(rankStep))
+            return (7 * k + distance - 1) * 64 + source;
+    return 0;
+}
+
+Move moveFromIndex(const MoveList& legal, int index) {
+    if (index < 0 || index >= POLICY_SIZE)
+        return 0;
+
+    int plane = index / 64, source = index % 64;
+    int fileStep, rankStep, promoted = 0;
+    if (plane < 56) {
+        int distance = plane % 7 + 1;
+        fileStep = queenSteps[plane / 7][0] * distance;
+        rankStep = queenSteps[plane / 7][1] * distance;
+    }
+    else if (plane < 64) {
+        fileStep = knightSteps[plane - 56][0];
+        rankStep = knightSteps[plane - 56][1];
+    }
+    else {
+        // pawns promote forward, white from the seventh rank and black from the second
+        promoted = Knight + (plane - 64) / 3;
+        fileStep = (plane - 64) % 3 - 1;
+        rankStep = source >> 3 == 6 ? 1 : -1;
+    }
+
+    int file = (source & 7) + fileStep, rank = (source >> 3) + rankStep;
+    if (file < 0 || file > 7 || rank < 0 || rank > 7)
+        return 0;
+    int target = rank * 8 + file;
+
+    // the queen planes stand for queen promotions
+    for (size_t i = 0; i < legal.size(); i++) {
+        MoveStore m(legal[i]);
+        if (m.getSource() == source && m.getTarget() == target
+            && (m.getPromoted() == promoted || (!promoted && m.getPromoted() == Queen)))
+            return legal[i];
+    }
+    return 0;
+}
+
+void policyMask(const MoveList& legal, uint8_t* out) {
+    std::memset(out, 0, POLICY_SIZE);
+    for (size_t i = 0; i < legal.size(); i++)
+        out[moveToIndex(legal[i])] = 1;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+
+#include "chess.h"
+
+// AlphaZero move encoding: 73 planes of 8x8 from-squares, index = plane * 64 + source,
+// so a policy reshapes to (73, 8, 8) like the input planes (square = rank * 8 + file,
+// from white's point of view whatever the side to move):
+//
+//   0-55   queen-like moves, 7 * direction + distance - 1, directions N NE E SE S SW W NW;
+//          also covers king moves, castling (two squares sideways) and queen promotions
+//   56-63  knight jumps (+1,+2) (+2,+1) (+2,-1) (+1,-2) (-1,-2) (-2,-1) (-2,+1) (-1,+2) as (file, rank)
+//   64-72  under-promotions, 3 * (piece - knight) + file step + 1, piece knight / bishop / rook
+
+constexpr int POLICY_PLANES = 73;
+constexpr int POLICY_SIZE = POLICY_PLANES * 64;
+
+int moveToIndex(Move move);
+
+// the legal move with that index, 0 if there is none
+Move moveFromIndex(const MoveList& legal, int index);
+
+// out holds POLICY_SIZE bytes, set to 1 for the legal moves and 0 elsewhere
+void policyMask(const MoveList& legal, uint8_t* out);
@@ -1,20 +1,335 @@
 from __future__ import annotations
+import collections.abc
 import numpy
 import numpy.typing
 import typing
-__all__: list[str] = ['Board', 'State']
+__all__: list[str] = ['Board', 'BoardBatch', 'CHECKMATE', 'FIFTY_MOVES', 'GameStatus', 'INSUFFICIENT_MATERIAL', 'MCTS', 'ONGOING', 'POLICY_SIZE', 'PackedDataset', 'PackedWriter', 'REPETITION', 'STALEMATE', 'Search', 'State', 'batch_legal_masks', 'batch_legal_moves', 'batch_states', 'batch_status', 'encode_boards', 'encode_fens', 'init_book', 'init_syzygy', 'load_nnue', 'move_to_index', 'move_to_uci', 'moves_to_indices', 'moves_to_uci', 'nnue_simd', 'pawn_table_stats', 'pgn_to_packed', 'read_pgn', 'rollout', 'rollout_batch', 'self_play', 'set_batch_threads', 'tensor_planes']
 class Board:
+    def __copy__(self) -> Board:
+        ...
+    def __deepcopy__(self, memo: dict) -> Board:
+        ...
+    def __getstate__(self) -> bytes:
+        ...
     def __init__(self) -> None:
         ...
+    def __setstate__(self, arg0: bytes) -> None:
+        ...
+    def apply_uci(self, moves: str | collections.abc.Sequence[str], push: bool = False) -> None:
+        """
+        Play a sequence of long algebraic moves ('e2e4 e7e5 ...' or a list), with push() when push=True; ValueError (board unchanged) at the first illegal one
+        """
+    def book_move(self, best: bool = False) -> int | None:
+        """
+        Book move picked in proportion to its weight (or the heaviest with best=True), None if out of book
+        """
+    def book_moves(self) -> list[tuple[int, int]]:
+        """
+        Legal book moves of the position as (move, weight) pairs
+        """
+    def copy(self, stack: bool = True) -> Board:
+        """
+        Independent copy of the position and its repetition history, with the move stack unless stack=False
+        """
+    def encode(self, out: numpy.ndarray, attacks: bool = False) -> None:
+        """
+        Write the input planes into out, a preallocated (C, 8, 8) float32 or uint8 array
+        """
+    def evaluate(self) -> int:
+        """
+        Static evaluation in centipawns from the side to move's point of view
+        """
+    def evaluate_nnue(self) -> int:
+        """
+        NNUE evaluation in centipawns from the side to move's point of view, falls back to evaluate() without a network
+        """
+    def from_bytes(self, data: bytes) -> None:
+        """
+        Restore a position written by to_bytes
+        """
+    def from_packed(self, data: bytes) -> None:
+        """
+        Set the position of a packed record, ValueError (board unchanged) if it is invalid
+        """
     def get_state(self) -> State:
         ...
+    def is_draw(self) -> bool:
+        """
+        Draw by threefold repetition or the fifty-move rule, counted from the last parse_fen
+        """
+    def legal_mask(self, out: numpy.ndarray) -> None:
+        """
+        Policy mask into out, a preallocated (4672,) or (73, 8, 8) bool or uint8 array
+        """
     def legal_moves(self) -> numpy.typing.NDArray[numpy.uint32]:
         ...
     def make_move(self, move: typing.SupportsInt) -> bool:
         ...
+    def move_from_index(self, index: typing.SupportsInt) -> int | None:
+        """
+        Legal move with that policy index, None if there is none
+        """
+    def move_to_san(self, move: typing.SupportsInt) -> str:
+        """
+        SAN of a legal move, such as 'Nbd7', 'exd8=Q+' or 'O-O-O'
+        """
+    def moves_to_san(self, moves: numpy.typing.ArrayLike, line: bool = False) -> numpy.typing.NDArray[numpy.str_]:
+        """
+        SAN of every move as a numpy string array: each a legal move of this position, or with line=True a sequence played from it (the board is left unchanged)
+        """
+    def parse_epd(self, epd: str) -> dict[str, str]:
+        """
+        Parse an EPD line, returns its operations as {opcode: operand}
+        """
     def parse_fen(self, fen: str) -> None:
         """
-        Parse a FEN string and set the board state accordingly
+        Parse a FEN string and set the board state accordingly, ValueError (board unchanged) if it is invalid
+        """
+    def parse_san(self, san: str) -> int | None:
+        """
+        Legal move of a SAN string such as 'Nbd7', 'exd8=Q+' or 'O-O-O', None if it names none or is ambiguous
+        """
+    def parse_uci(self, move: str) -> int | None:
+        """
+        Legal move of a long algebraic string such as 'e7e8q', None if it names none
+        """
+    def polyglot_key(self) -> int:
+        """
+        Position key used by Polyglot opening books
+        """
+    def pop(self) -> int:
+        """
+        Take back the last pushed move and return it
+        """
+    def probe_dtz(self) -> int | None:
+        """
+        Plies to the next capture or pawn move with optimal play, None if not available
+        """
+    def probe_wdl(self) -> int | None:
+        """
+        Tablebase result for the side to move (-2 loss .. 2 win), None if not available
+        """
+    def push(self, move: typing.SupportsInt) -> bool:
+        """
+        make_move that can be taken back with pop(), False (and no change) if the move is illegal
+        """
+    def status(self) -> GameStatus:
+        """
+        GameStatus of the position: checkmate and stalemate, then draws by the fifty-move rule, threefold repetition and insufficient material; stops at the first legal move instead of generating them all
+        """
+    def to_bytes(self) -> bytes:
+        """
+        Compact binary image of the position (no move stack), also used for pickling
+        """
+    def to_packed(self, score: typing.SupportsInt = 0, move: typing.SupportsInt = 0, result: typing.SupportsInt = 0) -> bytes:
+        """
+        32-byte packed record of the position, as PackedWriter.write stores it
+        """
+    def to_fen(self) -> str:
+        """
+        FEN of the position
+        """
+    def undo_depth(self) -> int:
+        """
+        Number of moves pop() can take back
+        """
+class BoardBatch:
+    def __getitem__(self, index: typing.SupportsInt) -> Board:
+        """
+        Copy of one board
+        """
+    def __init__(self, count: typing.SupportsInt, fen: str = 'rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1') -> None:
+        """
+        count games, all starting from fen
+        """
+    def __len__(self) -> int:
+        ...
+    def encode(self, out: numpy.ndarray, attacks: bool = False) -> None:
+        """
+        Write the input planes of every board into out, a preallocated (N, C, 8, 8) float32 or uint8 array
+        """
+    def legal_mask(self, out: numpy.ndarray) -> None:
+        """
+        Policy masks of every board into out, a preallocated (N, 4672) or (N, 73, 8, 8) bool or uint8 array
+        """
+    def legal_move_masks(self) -> numpy.typing.NDArray[numpy.bool_]:
+        """
+        (N, 64, 64) bool array, masks[i, from, to] is set for every legal move of board i
+        """
+    def legal_moves(self) -> dict:
+        """
+        Legal moves of every board: moves[offsets[i]:offsets[i + 1]] belong to board i
+        """
+    def moves_from_indices(self, indices: numpy.typing.ArrayLike) -> numpy.typing.NDArray[numpy.uint32]:
+        """
+        Legal move of every board for its policy index, 0 where the index is not legal; ready for step()
+        """
+    def reset(self, indices: collections.abc.Sequence[typing.SupportsInt], fens: collections.abc.Sequence[str]) -> None:
+        """
+        Start new games on the given boards from one FEN each, or from a single FEN for all
+        """
+    def step(self, moves: numpy.typing.ArrayLike) -> numpy.typing.NDArray[numpy.bool_]:
+        """
+        Play moves[i] on board i (0 to skip), returns which boards moved; illegal moves and finished games are skipped
+        """
+    @property
+    def draw(self) -> numpy.typing.NDArray[numpy.bool_]:
+        """
+        Boards whose game ended in a draw
+        """
+    @property
+    def result(self) -> numpy.typing.NDArray[numpy.int8]:
+        """
+        1 white won, -1 black won, 0 for draws and running games
+        """
+    @property
+    def status(self) -> numpy.typing.NDArray[numpy.uint8]:
+        """
+        GameStatus code of every board
+        """
+    @property
+    def terminal(self) -> numpy.typing.NDArray[numpy.bool_]:
+        """
+        Boards whose game is over
+        """
+class GameStatus:
+    """
+    Members:
+
+      ONGOING
+
+      CHECKMATE
+
+      STALEMATE
+
+      FIFTY_MOVES
+
+      REPETITION
+
+      INSUFFICIENT_MATERIAL
+    """
+    CHECKMATE: typing.ClassVar[GameStatus]  # value = <GameStatus.CHECKMATE: 1>
+    FIFTY_MOVES: typing.ClassVar[GameStatus]  # value = <GameStatus.FIFTY_MOVES: 3>
+    INSUFFICIENT_MATERIAL: typing.ClassVar[GameStatus]  # value = <GameStatus.INSUFFICIENT_MATERIAL: 5>
+    ONGOING: typing.ClassVar[GameStatus]  # value = <GameStatus.ONGOING: 0>
+    REPETITION: typing.ClassVar[GameStatus]  # value = <GameStatus.REPETITION: 4>
+    STALEMATE: typing.ClassVar[GameStatus]  # value = <GameStatus.STALEMATE: 2>
+    __members__: typing.ClassVar[dict[str, GameStatus]]
+    def __eq__(self, other: typing.Any) -> bool:
+        ...
+    def __hash__(self) -> int:
+        ...
+    def __index__(self) -> int:
+        ...
+    def __init__(self, value: typing.SupportsInt) -> None:
+        ...
+    def __int__(self) -> int:
+        ...
+    def __ne__(self, other: typing.Any) -> bool:
+        ...
+    @property
+    def name(self) -> str:
+        ...
+    @property
+    def value(self) -> int:
+        ...
+class MCTS:
+    def __init__(self, cpuct: typing.SupportsFloat = 1.5, batch_size: typing.SupportsInt = 16, virtual_loss: typing.SupportsFloat = 1.0, fpu_reduction: typing.SupportsFloat = 0.25, dirichlet_alpha: typing.SupportsFloat = 0.3, dirichlet_epsilon: typing.SupportsFloat = 0.0, seed: typing.SupportsInt = 0) -> None:
+        ...
+    def __len__(self) -> int:
+        """
+        Nodes in the tree
+        """
+    def best_move(self) -> int:
+        """
+        Most visited root move, 0 before any search
+        """
+    def root_children(self) -> dict:
+        """
+        Root moves with their priors, visits and mean values for the side to move
+        """
+    def search(self, simulations: typing.SupportsInt, evaluator: typing.Callable[[numpy.typing.NDArray[numpy.float32]], tuple[numpy.typing.ArrayLike, numpy.typing.ArrayLike]] | None = None, attacks: bool = False) -> None:
+        """
+        Add simulations to the tree. evaluator(planes) gets a (B, C, 8, 8) float32 batch and returns (policy logits (B, 4672), value (B,) for the side to move); None uses the engine evaluation
+        """
+    def set_root(self, board: Board) -> None:
+        """
+        Start a new tree at the position
+        """
+    def visit_policy(self) -> numpy.typing.NDArray[numpy.float32]:
+        """
+        Root visit shares as a (4672,) float32 policy target
+        """
+    @property
+    def root_value(self) -> float:
+        """
+        Mean value for the side to move at the root
+        """
+    @property
+    def root_visits(self) -> int:
+        ...
+class PackedDataset:
+    def __getitem__(self, index: typing.SupportsInt) -> Board:
+        """
+        Board of one record
+        """
+    def __init__(self, path: str) -> None:
+        """
+        Random access to a file of packed records through a read-only memory mapping
+        """
+    def __len__(self) -> int:
+        ...
+    def batch(self, indices: numpy.typing.ArrayLike, out: numpy.ndarray | None = None, attacks: bool = False) -> dict:
+        """
+        Decode records into input planes (into out, or a new float32 array), score, result and the move as an engine move (0 for none)
+        """
+    def records(self, indices: numpy.typing.ArrayLike) -> numpy.typing.NDArray[numpy.uint8]:
+        """
+        Raw records as an (N, 32) uint8 array, accepted by the batch_* functions and encode_fens
+        """
+class PackedWriter:
+    def __enter__(self) -> PackedWriter:
+        ...
+    def __exit__(self, *args) -> None:
+        ...
+    def __init__(self, path: str, append: bool = False) -> None:
+        """
+        Write 32-byte packed position records to path
+        """
+    def __len__(self) -> int:
+        """
+        Records written
+        """
+    def close(self) -> None:
+        """
+        Flush and close the file
+        """
+    def write(self, board: Board, score: typing.SupportsInt = 0, move: typing.SupportsInt = 0, result: typing.SupportsInt = 0) -> None:
+        """
+        Append a record: score in centipawns, the move played (0 for none) and the result (1, 0, -1), all from the side to move's point of view
+        """
+class Search:
+    def __init__(self, threads: typing.SupportsInt = 1, hash: typing.SupportsInt = 16) -> None:
+        ...
+    def analyse(self, board: Board, multipv: typing.SupportsInt = 1, depth: typing.SupportsInt = 0, nodes: typing.SupportsInt = 0, movetime: typing.SupportsInt = 0) -> dict:
+        """
+        Best lines of the position, best first: dict of moves, scores, depths, pv_lengths and 0-padded pvs arrays
+        """
+    def analyse_batch(self, fens: collections.abc.Sequence[str], multipv: typing.SupportsInt = 1, depth: typing.SupportsInt = 0, nodes: typing.SupportsInt = 0, movetime: typing.SupportsInt = 0) -> dict:
+        """
+        analyse() for every position with the limits applied per position, arrays gain a leading position axis
+        """
+    def clear(self) -> None:
+        """
+        Forget the transposition table and move ordering history
+        """
+    def set_hash(self, megabytes: typing.SupportsInt) -> None:
+        ...
+    def set_threads(self, count: typing.SupportsInt) -> None:
+        ...
+    def stats(self) -> dict:
+        """
+        Counters of the last search summed over threads (per thread under 'threads'), zero unless built with CHESS_STATS
         """
 class State:
     @property
@@ -35,3 +350,98 @@ class State:
     @property
     def side(self) -> int:
         ...
+def batch_legal_masks(fens: collections.abc.Sequence[str] | numpy.typing.NDArray[numpy.uint8], out: numpy.ndarray) -> None:
+    """
+    Policy masks of every position (FEN strings or packed records) into out, a preallocated (N, 4672) or (N, 73, 8, 8) bool or uint8 array
+    """
+def batch_legal_moves(fens: collections.abc.Sequence[str] | numpy.typing.NDArray[numpy.uint8]) -> dict:
+    """
+    Legal moves of every position (FEN strings or an (N, 32) uint8 array of packed records): moves[offsets[i]:offsets[i + 1]] belong to fens[i]; also in_check flags
+    """
+def batch_states(fens: collections.abc.Sequence[str] | numpy.typing.NDArray[numpy.uint8]) -> dict:
+    """
+    State of every position (FEN strings or packed records) as arrays with a leading position axis: pieces, occupancy, side, castling, enpassant, in_check
+    """
+def batch_status(fens: collections.abc.Sequence[str] | numpy.typing.NDArray[numpy.uint8]) -> numpy.typing.NDArray[numpy.uint8]:
+    """
+    GameStatus code of every position (FEN strings or packed records), see Board.status
+    """
+def encode_boards(boards: collections.abc.Sequence[Board], out: numpy.ndarray, attacks: bool = False) -> None:
+    """
+    Write the input planes of every board into out, a preallocated (N, C, 8, 8) float32 or uint8 array
+    """
+def encode_fens(fens: collections.abc.Sequence[str] | numpy.typing.NDArray[numpy.uint8], out: numpy.ndarray, attacks: bool = False) -> None:
+    """
+    encode_boards for FEN strings or an (N, 32) uint8 array of packed records
+    """
+def init_book(path: str) -> bool:
+    """
+    Memory-map a Polyglot opening book, returns False if the file is missing or malformed
+    """
+def init_syzygy(paths: str) -> int:
+    """
+    Register the Syzygy tables found in the given directories, returns the number of files
+    """
+def load_nnue(path: str) -> bool:
+    """
+    Load NNUE weights from a local file, returns False if the file is missing or malformed
+    """
+def move_to_index(move: typing.SupportsInt) -> int:
+    """
+    AlphaZero policy index (plane * 64 + source, 73 planes) of a move
+    """
+def move_to_uci(move: typing.SupportsInt) -> str:
+    """
+    Long algebraic notation of a move, such as 'e7e8q'
+    """
+def moves_to_indices(moves: numpy.typing.ArrayLike) -> numpy.typing.NDArray[numpy.int32]:
+    """
+    move_to_index of every element, same shape
+    """
+def moves_to_uci(moves: numpy.typing.ArrayLike) -> numpy.typing.NDArray[numpy.str_]:
+    """
+    move_to_uci of every element as a numpy string array of the same shape
+    """
+def nnue_simd() -> str:
+    """
+    Instruction set selected at runtime for the NNUE kernels
+    """
+def pawn_table_stats() -> dict:
+    """
+    Pawn hash table counters of the calling thread
+    """
+def pgn_to_packed(pgn_path: str, packed_path: str) -> dict:
+    """
+    Write every position of the fully decoded PGN mainlines with its move and game result as packed records, returns counts of games, moves, errors (games not fully decoded, skipped) and records
+    """
+def read_pgn(path: str) -> dict:
+    """
+    Mainlines of every game of a PGN file: moves[offsets[i]:offsets[i + 1]] belong to game i, results (1, 0, -1 from white's point of view, 2 unknown), complete flags and FEN tags ('' for the start position)
+    """
+def rollout(board: Board, n: typing.SupportsInt, max_plies: typing.SupportsInt = 0, seed: typing.SupportsInt = 0, weighted: bool = False) -> dict:
+    """
+    Play n random games from the position on the thread pool (weighted: captures and promotions 4x as likely), at most max_plies plies each (0 = to the end); returns counts of games, white_wins, black_wins, draws, unfinished (stopped at max_plies) and plies
+    """
+def rollout_batch(fens: collections.abc.Sequence[str] | numpy.typing.NDArray[numpy.uint8], n: typing.SupportsInt, max_plies: typing.SupportsInt = 0, seed: typing.SupportsInt = 0, weighted: bool = False) -> dict:
+    """
+    rollout() from every position (FEN strings or packed records), counts as arrays with a leading position axis
+    """
+def self_play(path: str, games: typing.SupportsInt, threads: typing.SupportsInt = 0, depth: typing.SupportsInt = 0, nodes: typing.SupportsInt = 0, hash: typing.SupportsInt = 16, openings: str = '', random_plies: typing.SupportsInt = 8, seed: typing.SupportsInt = 0, max_plies: typing.SupportsInt = 400, resign_score: typing.SupportsInt = 1500, resign_plies: typing.SupportsInt = 6, draw_score: typing.SupportsInt = 10, draw_plies: typing.SupportsInt = 12, draw_min_ply: typing.SupportsInt = 80, tablebases: bool = True, policy: typing.Any = None) -> dict:
+    """
+    Play games on worker threads with a fixed search per move (depth and / or nodes, 5000 nodes when neither is given), or policy(board) -> move or (move, score), and write every position after the opening as packed records with its score and the game result. Openings are random lines of an EPD file followed by random_plies random moves; games are adjudicated by length, resign and draw scores and tablebases. Returns counts of games, records, white_wins, black_wins, draws, adjudicated and errors (games dropped for an illegal policy move)
+    """
+def set_batch_threads(threads: typing.SupportsInt) -> None:
+    """
+    Threads used by the batch_* functions, 0 for one per hardware thread
+    """
+def tensor_planes(attacks: bool = False) -> int:
+    """
+    Planes per position written by the encoders
+    """
+CHECKMATE: GameStatus  # value = <GameStatus.CHECKMATE: 1>
+FIFTY_MOVES: GameStatus  # value = <GameStatus.FIFTY_MOVES: 3>
+INSUFFICIENT_MATERIAL: GameStatus  # value = <GameStatus.INSUFFICIENT_MATERIAL: 5>
+ONGOING: GameStatus  # value = <GameStatus.ONGOING: 0>
+POLICY_SIZE: int = 4672
+REPETITION: GameStatus  # value = <GameStatus.REPETITION: 4>
+STALEMATE: GameStatus  # value = <GameStatus.STALEMATE: 2>
@@ -10,20 +10,19 @@ if __name__ == "__main__":
     board.parse_fen(fen)
 
     state = board.get_state()
-    legal_moves = board.legal_moves()
+    status = board.status()
 
     print("FEN:", fen)
     print("Parsed Board State:")    
     print(state.in_check)
 
 
-    print(legal_moves)
+    print(board.legal_moves())
 
-    if len(legal_moves) == 0:
-        if state.in_check:
-            print(f"{state.side} in Checkmate") 
-        else:
-            print(f"{state.side} in Stalemate")
+    if status == chess_engine.CHECKMATE:
+        print(f"{state.side} in Checkmate") 
+    elif status == chess_engine.STALEMATE:
+        print(f"{state.side} in Stalemate")
+    elif status != chess_engine.ONGOING:
+        print(f"Draw: {status.name}")
 
-
-    
\ No newline at end of file
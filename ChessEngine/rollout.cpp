@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <mutex>
+
+#include "rollout.h"
+#include "thread_pool.h"
+
+namespace {
+
+// games per pool task
+constexpr size_t ROLLOUT_GRAIN = 16;
+
+// captures and promotions (flag and promoted piece bits) are drawn this much more often
+constexpr uint32_t ROLLOUT_TACTICAL_WEIGHT = 4;
+constexpr Move TACTICAL_BITS = 0x1F0000;
+
+uint64_t splitmix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// xorshift64*, seeded through splitmix so neighbouring seeds give unrelated games
+struct Random {
+    uint64_t state;
+
+    explicit Random(uint64_t seed) : state(splitmix(seed) | 1) {}
+
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+
+    // uniform in [0, n) by multiply and shift
+    uint32_t below(uint32_t n) {
+        return static_cast<uint32_t>(((next() >> 32) * n) >> 32);
+    }
+};
+
+uint32_t moveWeight(Move move) {
+    return move & TACTICAL_BITS ? ROLLOUT_TACTICAL_WEIGHT : 1;
+}
+
+// makes a random legal move, false if there is none; illegal draws are dropped from
+// the list and drawn again
+bool playRandom(Board& board, MoveList& moves, Random& random, bool weighted) {
+    board.generateMoves(moves);
+    uint32_t count = static_cast<uint32_t>(moves.size());
+    while (count) {
+        uint32_t pick = 0;
+        if (weighted) {
+            uint32_t total = 0;
+            for (uint32_t i = 0; i < count; i++)
+                total += moveWeight(moves[i]);
+            for (uint32_t r = random.below(total); r >= moveWeight(moves[pick]); pick++)
+                r -= moveWeight(moves[pick]);
+        }
+        else {
+            pick = random.below(count);
+        }
+        if (board.makeMove(moves[pick], ALL_MOVES))
+            return true;
+        moves[pick] = moves[--count];
+    }
+    return false;
+}
+
+// plays one game from the current position of the board and leaves it at the end
+void playGame(Board& board, MoveList& moves, Random& random, int maxPlies, bool weighted, RolloutStats& stats) {
+    int ply = 0;
+    while (true) {
+        if (board.isRepetition(2) || board.insufficientMaterial()) {
+            stats.draws++;
+            break;
+        }
+        if (maxPlies && ply >= maxPlies) {
+            stats.unfinished++;
+            break;
+        }
+        // a mate on the hundredth ply still counts
+        int clock = board.getHalfmoveClock();
+        if (!playRandom(board, moves, random, weighted)) {
+            if (!board.inCheck())
+                stats.draws++;
+            else if (board.getSide() == White)
+                stats.blackWins++;
+            else
+                stats.whiteWins++;
+            break;
+        }
+        if (clock >= 100) {
+            stats.draws++;
+            break;
+        }
+        ply++;
+    }
+    stats.games++;
+    stats.plies += ply;
+}
+
+void addStats(RolloutStats& to, const RolloutStats& from) {
+    to.games += from.games;
+    to.whiteWins += from.whiteWins;
+    to.blackWins += from.blackWins;
+    to.draws += from.draws;
+    to.unfinished += from.unfinished;
+    to.plies += from.plies;
+}
+
+}
+
+RolloutStats rollout(const Board& board, size_t n, int maxPlies, uint64_t seed, bool weighted) {
+    RolloutStats stats;
+    rolloutBatch(&board, 1, n, maxPlies, seed, &stats, weighted);
+    return stats;
+}
+
+void rolloutBatch(const Board* boards, size_t count, size_t n, int maxPlies, uint64_t seed,
+    RolloutStats* out, bool weighted) {
+    std::fill(out, out + count, RolloutStats());
+    if (!n)
+        return;
+
+    // game g plays from board g / n; a task's games span few boards, so stats are summed
+    // locally and merged once per board
+    std::mutex mutex;
+    std::shared_ptr<ThreadPool> pool = ThreadPool::global();
+    pool->parallelFor(count * n, ROLLOUT_GRAIN, [&](size_t begin, size_t end) {
+        Board work;
+        MoveList moves;
+        BoardState start;
+        for (size_t game = begin; game < end;) {
+            size_t index = game / n;
+            size_t last = std::min(end, (index + 1) * n);
+            work = Board(boards[index], false);
+            work.copyState(start);
+
+            RolloutStats stats;
+            for (; game < last; game++) {
+                Random random(seed ^ splitmix(game));
+                work.restoreState(start);
+                playGame(work, moves, random, maxPlies, weighted, stats);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            addStats(out[index], stats);
+        }
+    });
+}
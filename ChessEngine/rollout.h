@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "chess.h"
+
+// Random playouts to the end of the game: moves are drawn from the pseudo-legal list
+// and only the one drawn is made, so a ply costs one move generation and usually one
+// makeMove. Every game restores the start position in place, nothing is allocated per game
+
+struct RolloutStats {
+    uint64_t games = 0;
+    uint64_t whiteWins = 0;
+    uint64_t blackWins = 0;
+    uint64_t draws = 0;            // stalemate, fifty moves, repetition, insufficient material
+    uint64_t unfinished = 0;       // stopped at maxPlies
+    uint64_t plies = 0;            // over all games
+};
+
+// n games from the position, at most maxPlies plies each (0 = no limit). weighted draws
+// captures and promotions four times as often as quiet moves. Game i uses a generator
+// seeded by seed and i, so the result does not depend on the thread count
+RolloutStats rollout(const Board& board, size_t n, int maxPlies, uint64_t seed, bool weighted = false);
+
+// n games from each board into out[count], on the batch thread pool
+void rolloutBatch(const Board* boards, size_t count, size_t n, int maxPlies, uint64_t seed,
+    RolloutStats* out, bool weighted = false);
@@ -0,0 +1,784 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "chess.h"
+#include "evaluate.h"
+#include "search.h"
+#include "syzygy.h"
+
+// move ordering buckets
+constexpr int TT_MOVE_SCORE = 2000000;
+constexpr int CAPTURE_SCORE = 1000000;
+constexpr int PROMOTION_SCORE = 900000;
+constexpr int KILLER_SCORE[2] = { 800000, 790000 };
+constexpr int HISTORY_MAX = 16384;
+
+// late move reductions [depth][move number]
+static const auto lmrTable = [] {
+    std::array<std::array<int, 64>, 64> table{};
+    for (int depth = 1; depth < 64; depth++)
+        for (int moves = 1; moves < 64; moves++)
+            table[depth][moves] = static_cast<int>(0.75 + std::log(depth) * std::log(moves) / 2.25);
+    return table;
+    }();
+
+// transposition table //
+TranspositionTable::TranspositionTable() : count(0) {
+    resize(16);
+}
+
+void TranspositionTable::resize(size_t megabytes) {
+    // round down to a power of two so the index is a mask
+    size_t wanted = std::max<size_t>(megabytes, 1) * 1024 * 1024 / sizeof(Entry);
+    count = 1;
+    while (count * 2 <= wanted)
+        count *= 2;
+
+    entries.reset(new Entry[count]);
+    clear();
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i < count; i++) {
+        entries[i].key.store(0, std::memory_order_relaxed);
+        entries[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+//  bits 0-23 move, 24-39 score, 40-47 depth, 48-49 flag
+static uint64_t packEntry(Move move, int score, int depth, int flag) {
+    return (uint64_t)(move & 0xFFFFFF)
+        | ((uint64_t)(uint16_t)(int16_t)score << 24)
+        | ((uint64_t)(uint8_t)depth << 40)
+        | ((uint64_t)flag << 48);
+}
+
+bool TranspositionTable::probe(uint64_t key, TTData& out) const {
+    const Entry& entry = entries[key & (count - 1)];
+    uint64_t data = entry.data.load(std::memory_order_relaxed);
+    if ((entry.key.load(std::memory_order_relaxed) ^ data) != key || !data)
+        return false;
+
+    out.move = static_cast<Move>(data & 0xFFFFFF);
+    out.score = (int16_t)(uint16_t)(data >> 24);
+    out.depth = (uint8_t)(data >> 40);
+    out.flag = (data >> 48) & 3;
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, Move move, int score, int depth, int flag) {
+    Entry& entry = entries[key & (count - 1)];
+
+    // keep the old move if we have nothing better for the same position
+    if (!move) {
+        uint64_t old = entry.data.load(std::memory_order_relaxed);
+        if ((entry.key.load(std::memory_order_relaxed) ^ old) == key)
+            move = static_cast<Move>(old & 0xFFFFFF);
+    }
+
+    uint64_t data = packEntry(move, score, std::max(depth, 0), flag);
+    entry.key.store(key ^ data, std::memory_order_relaxed);
+    entry.data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+    size_t sample = std::min<size_t>(count, 1000);
+    int used = 0;
+    for (size_t i = 0; i < sample; i++)
+        used += entries[i].data.load(std::memory_order_relaxed) != 0;
+    return static_cast<int>(used * 1000 / sample);
+}
+
+// mate and tablebase scores are stored relative to the node, not the root
+static int scoreToTT(int score, int ply) {
+    return score > TB_WIN_BOUND ? score + ply : score < -TB_WIN_BOUND ? score - ply : score;
+}
+
+static int scoreFromTT(int score, int ply) {
+    return score > TB_WIN_BOUND ? score - ply : score < -TB_WIN_BOUND ? score + ply : score;
+}
+
+std::string scoreToString(int score) {
+    if (score > MATE_BOUND)
+        return "mate " + std::to_string((MATE_SCORE - score + 1) / 2);
+    // mated at the root itself is "mate 0", not "mate -0"
+    if (score < -MATE_BOUND)
+        return score == -MATE_SCORE ? "mate 0" : "mate -" + std::to_string((MATE_SCORE + score) / 2);
+    return "cp " + std::to_string(score);
+}
+
+// search worker //
+class SearchWorker {
+public:
+    SearchWorker(Search& search, int id);
+    ~SearchWorker();
+
+    Search& search;
+    int id;
+    Board board;
+
+    bool searching;
+    bool exiting;
+    std::thread thread;
+
+    std::atomic<uint64_t> nodes;
+    std::atomic<uint64_t> tbHits;
+    int tbPieces;
+    int completedDepth;
+    int bestScore;
+    std::vector<Move> rootPv;
+    std::vector<PVLine> lines;       // of the last completed iteration
+    std::vector<Move> excluded;      // root moves of the lines already searched this iteration
+    SearchStats stats;
+    PawnTableStats pawnStart;
+
+    Move killers[MAX_PLY][2];
+    int history[2][64][64];
+    Move pvTable[MAX_PLY][MAX_PLY];
+    int pvLength[MAX_PLY];
+
+    void idleLoop();
+    void iterate();
+    int negamax(int alpha, int beta, int depth, int ply, bool allowNull);
+    int quiescence(int alpha, int beta, int ply);
+
+private:
+    int evaluate();
+    void scoreMoves(const MoveList& moves, int* scores, Move ttMove, int ply);
+    Move pickMove(MoveList& moves, int* scores, size_t index);
+    void updatePv(Move move, int ply);
+    void checkLimits();
+    void finish();
+};
+
+SearchWorker::SearchWorker(Search& search, int id)
+    : search(search), id(id), searching(false), exiting(false), nodes(0),
+    tbHits(0), tbPieces(0), completedDepth(0), bestScore(0), pawnStart{}
+{
+    memset(history, 0, sizeof(history));
+    thread = std::thread(&SearchWorker::idleLoop, this);
+}
+
+SearchWorker::~SearchWorker() {
+    {
+        std::lock_guard<std::mutex> lock(search.mutex);
+        exiting = true;
+    }
+    search.cv.notify_all();
+    thread.join();
+}
+
+void SearchWorker::idleLoop() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(search.mutex);
+            search.cv.wait(lock, [this] { return searching || exiting; });
+            if (exiting)
+                return;
+        }
+
+        iterate();
+
+        {
+            std::lock_guard<std::mutex> lock(search.mutex);
+            searching = false;
+            search.running--;
+        }
+        search.cv.notify_all();
+    }
+}
+
+int SearchWorker::evaluate() {
+    return nnueIsLoaded() ? board.evaluateNNUE() : board.evaluate();
+}
+
+void SearchWorker::checkLimits() {
+    if (id != 0 || search.ponderFlag)
+        return;
+
+    int64_t elapsed = get_time_ms() - search.startTime;
+    if ((search.hardLimit && elapsed >= search.hardLimit)
+        || (search.limits.nodes && search.totalNodes() >= search.limits.nodes))
+        search.stopFlag = true;
+}
+
+void SearchWorker::updatePv(Move move, int ply) {
+    pvTable[ply][ply] = move;
+    for (int next = ply + 1; next < pvLength[ply + 1]; next++)
+        pvTable[ply][next] = pvTable[ply + 1][next];
+    pvLength[ply] = pvLength[ply + 1];
+}
+
+void SearchWorker::scoreMoves(const MoveList& moves, int* scores, Move ttMove, int ply) {
+    for (size_t i = 0; i < moves.size(); i++) {
+        Move move = moves[i];
+        MoveStore m(move);
+
+        if (move == ttMove) {
+            scores[i] = TT_MOVE_SCORE;
+        }
+        else if (m.isCapture()) {
+            // most valuable victim, least valuable attacker
+            int victim = m.isEnPassant() ? Pawn : board.pieceOn(m.getTarget());
+            scores[i] = CAPTURE_SCORE + victim * 10 - m.getPiece() + m.getPromoted();
+        }
+        else if (m.getPromoted()) {
+            scores[i] = PROMOTION_SCORE + m.getPromoted();
+        }
+        else if (move == killers[ply][0]) {
+            scores[i] = KILLER_SCORE[0];
+        }
+        else if (move == killers[ply][1]) {
+            scores[i] = KILLER_SCORE[1];
+        }
+        else {
+            scores[i] = history[m.getColor()][m.getSource()][m.getTarget()];
+        }
+    }
+}
+
+// selection sort step, moves are usually cut off long before the list is sorted
+Move SearchWorker::pickMove(MoveList& moves, int* scores, size_t index) {
+    size_t best = index;
+    for (size_t i = index + 1; i < moves.size(); i++) {
+        if (scores[i] > scores[best])
+            best = i;
+    }
+    std::swap(moves[index], moves[best]);
+    std::swap(scores[index], scores[best]);
+    return moves[index];
+}
+
+int SearchWorker::quiescence(int alpha, int beta, int ply) {
+
+    STATS_INC(qnodes);
+    if ((nodes.fetch_add(1, std::memory_order_relaxed) & 1023) == 0)
+        checkLimits();
+
+    if (search.stopFlag)
+        return 0;
+
+    int standPat = evaluate();
+    if (ply >= MAX_PLY - 1)
+        return standPat;
+
+    if (standPat >= beta)
+        return standPat;
+    if (standPat > alpha)
+        alpha = standPat;
+
+    // captures and every promotion, quiet ones included (scored just below the captures)
+    MoveList moves;
+    board.generateMoves(moves, GEN_CAPTURES);
+    int scores[256];
+    scoreMoves(moves, scores, 0, ply);
+
+    for (size_t i = 0; i < moves.size(); i++) {
+        Move move = pickMove(moves, scores, i);
+        if (scores[i] < PROMOTION_SCORE)
+            break;
+
+        BoardState state;
+        board.copyState(state);
+        if (!board.makeMove(move, ALL_MOVES))
+            continue;
+
+        int score = -quiescence(-beta, -alpha, ply + 1);
+        board.restoreState(state);
+
+        if (search.stopFlag)
+            return 0;
+
+        if (score > alpha) {
+            alpha = score;
+            if (score >= beta)
+                return score;
+        }
+    }
+    return alpha;
+}
+
+int SearchWorker::negamax(int alpha, int beta, int depth, int ply, bool allowNull) {
+
+    pvLength[ply] = ply;
+    bool pvNode = beta - alpha > 1;
+
+    // a repetition since the last irreversible move is scored as a draw on its first
+    // occurrence, searching on could only reach the same position again
+    if (ply > 0 && (board.getHalfmoveClock() >= 100 || board.isRepetition()))
+        return 0;
+
+    bool inCheck = board.inCheck();
+
+    // check extension
+    if (inCheck)
+        depth++;
+
+    if (depth <= 0)
+        return quiescence(alpha, beta, ply);
+
+    STATS_INC(nodes);
+    if ((nodes.fetch_add(1, std::memory_order_relaxed) & 1023) == 0)
+        checkLimits();
+
+    if (search.stopFlag)
+        return 0;
+
+    if (ply >= MAX_PLY - 1)
+        return evaluate();
+
+    // transposition table
+    uint64_t key = board.getHashKey();
+    TTData tte{};
+    bool ttHit = search.tt.probe(key, tte);
+    Move ttMove = ttHit ? tte.move : 0;
+    STATS_INC(ttProbes);
+    if (ttHit)
+        STATS_INC(ttHits);
+
+    if (ttHit && !pvNode && ply > 0 && tte.depth >= depth) {
+        int ttScore = scoreFromTT(tte.score, ply);
+        if (tte.flag == TT_EXACT
+            || (tte.flag == TT_LOWER && ttScore >= beta)
+            || (tte.flag == TT_UPPER && ttScore <= alpha)) {
+            STATS_INC(ttCutoffs);
+            return ttScore;
+        }
+    }
+
+    // tablebase probe, exact results for small endgames
+    if (ply > 0 && tbPieces && countBits(board.getOccupancy(All)) <= tbPieces) {
+        bool ok;
+        WDLScore wdl = syzygyProbeWDL(board, ok);
+        if (ok) {
+            tbHits.fetch_add(1, std::memory_order_relaxed);
+
+            // cursed wins and blessed losses are draws under the 50-move rule
+            int score = wdl == WDL_WIN ? TB_WIN_SCORE - ply : wdl == WDL_LOSS ? -TB_WIN_SCORE + ply : wdl;
+            int flag = wdl == WDL_WIN ? TT_LOWER : wdl == WDL_LOSS ? TT_UPPER : TT_EXACT;
+
+            if (flag == TT_EXACT || (flag == TT_LOWER ? score >= beta : score <= alpha)) {
+                search.tt.store(key, 0, scoreToTT(score, ply), std::min(depth + 6, MAX_PLY - 1), flag);
+                return score;
+            }
+        }
+    }
+
+    if (!pvNode && !inCheck) {
+        int staticEval = evaluate();
+
+        // reverse futility pruning
+        if (depth <= 6 && staticEval - 80 * depth >= beta)
+            return staticEval;
+
+        // null move pruning, not in pawn endings where zugzwang is common
+        Color us = static_cast<Color>(board.getSide());
+        bool hasPieces = board.getOccupancy(us) & ~(board.getPieces(us, Pawn) | board.getPieces(us, King));
+        if (allowNull && depth >= 3 && staticEval >= beta && hasPieces) {
+            int reduction = 3 + depth / 4;
+            STATS_INC(nullMoveTries);
+
+            BoardState state;
+            board.copyState(state);
+            board.makeNullMove();
+            int score = -negamax(-beta, -beta + 1, depth - reduction, ply + 1, false);
+            board.restoreState(state);
+
+            if (search.stopFlag)
+                return 0;
+            if (score >= beta) {
+                STATS_INC(nullMoveCutoffs);
+                return score > TB_WIN_BOUND ? beta : score;
+            }
+        }
+    }
+
+    MoveList moves;
+    board.generateMoves(moves, inCheck ? GEN_EVASIONS : GEN_ALL);
+    int scores[256];
+    scoreMoves(moves, scores, ttMove, ply);
+
+    int bestScore = -INF_SCORE;
+    Move bestMove = 0;
+    int flag = TT_UPPER;
+    int legalMoves = 0;
+
+    for (size_t i = 0; i < moves.size(); i++) {
+        Move move = pickMove(moves, scores, i);
+        MoveStore m(move);
+
+        if (ply == 0 && ((!search.rootMoves.empty()
+            && std::find(search.rootMoves.begin(), search.rootMoves.end(), move) == search.rootMoves.end())
+            || std::find(excluded.begin(), excluded.end(), move) != excluded.end()))
+            continue;
+
+        BoardState state;
+        board.copyState(state);
+        if (!board.makeMove(move, ALL_MOVES))
+            continue;
+        legalMoves++;
+
+        bool quiet = !m.isCapture() && !m.getPromoted();
+        int score;
+
+        if (legalMoves == 1) {
+            score = -negamax(-beta, -alpha, depth - 1, ply + 1, true);
+        }
+        else {
+            // late move reductions for quiet moves that don't check
+            int reduction = 0;
+            if (depth >= 3 && legalMoves > 3 && quiet && !inCheck && !board.inCheck()) {
+                reduction = lmrTable[std::min(depth, 63)][std::min(legalMoves, 63)];
+                if (pvNode)
+                    reduction--;
+                reduction = std::clamp(reduction, 0, depth - 2);
+            }
+
+            // principal variation search
+            if (reduction)
+                STATS_INC(lmrReductions);
+            score = -negamax(-alpha - 1, -alpha, depth - 1 - reduction, ply + 1, true);
+            if (score > alpha && reduction) {
+                STATS_INC(lmrResearches);
+                score = -negamax(-alpha - 1, -alpha, depth - 1, ply + 1, true);
+            }
+            if (score > alpha && score < beta)
+                score = -negamax(-beta, -alpha, depth - 1, ply + 1, true);
+        }
+
+        board.restoreState(state);
+
+        if (search.stopFlag)
+            return 0;
+
+        if (score > bestScore) {
+            bestScore = score;
+            bestMove = move;
+
+            if (score > alpha) {
+                alpha = score;
+                flag = TT_EXACT;
+                updatePv(move, ply);
+
+                if (score >= beta) {
+                    flag = TT_LOWER;
+                    STATS_INC(betaCutoffs);
+                    if (legalMoves == 1)
+                        STATS_INC(firstMoveCutoffs);
+                    if (quiet) {
+                        if (killers[ply][0] != move) {
+                            killers[ply][1] = killers[ply][0];
+                            killers[ply][0] = move;
+                        }
+                        int& h = history[m.getColor()][m.getSource()][m.getTarget()];
+                        int bonus = std::min(depth * depth, 400);
+                        h += bonus - h * bonus / HISTORY_MAX;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    // checkmate or stalemate
+    if (legalMoves == 0)
+        return inCheck ? -MATE_SCORE + ply : 0;
+
+    // the root of a secondary line is missing the better moves, its entry would be wrong
+    if (ply > 0 || excluded.empty())
+        search.tt.store(key, bestMove, scoreToTT(bestScore, ply), depth, flag);
+    return bestScore;
+}
+
+void SearchWorker::iterate() {
+
+    completedDepth = 0;
+    bestScore = 0;
+    rootPv.clear();
+    lines.clear();
+    tbPieces = syzygyMaxPieces();
+    memset(killers, 0, sizeof(killers));
+    pawnStart = pawnTableStats();
+
+    // no more lines than root moves
+    size_t rootCount = search.rootMoves.empty() ? board.legalMoves().size() : search.rootMoves.size();
+    int multiPV = std::clamp<int>(search.limits.multiPV, 1, std::max<int>(rootCount, 1));
+    std::vector<PVLine> current(multiPV);
+
+#ifdef CHESS_STATS
+    uint64_t iterationStart = 0, lastIteration = 0;
+#endif
+
+    // helpers start one ply deeper every other thread to spread the work
+    for (int depth = 1 + (id & 1); depth <= search.limits.depth; depth++) {
+
+        // each line searches the root without the moves of the lines above it
+        excluded.clear();
+        for (int pvIdx = 0; pvIdx < multiPV; pvIdx++) {
+
+            // aspiration window around the previous score of this line
+            int score = current[pvIdx].score;
+            int delta = 25;
+            int alpha = -INF_SCORE, beta = INF_SCORE;
+            if (depth >= 5) {
+                alpha = std::max(score - delta, -INF_SCORE);
+                beta = std::min(score + delta, INF_SCORE);
+            }
+
+            while (true) {
+                score = negamax(alpha, beta, depth, 0, false);
+                if (search.stopFlag)
+                    break;
+
+                if (score <= alpha) {
+                    beta = (alpha + beta) / 2;
+                    alpha = std::max(score - delta, -INF_SCORE);
+                }
+                else if (score >= beta) {
+                    beta = std::min(score + delta, INF_SCORE);
+                }
+                else {
+                    break;
+                }
+                delta += delta / 2;
+            }
+
+            if (search.stopFlag)
+                break;
+
+            current[pvIdx].score = score;
+            current[pvIdx].depth = depth;
+            current[pvIdx].pv.assign(pvTable[0], pvTable[0] + pvLength[0]);
+
+            // checkmate or stalemate at the root
+            if (!pvLength[0])
+                break;
+            excluded.push_back(pvTable[0][0]);
+        }
+        excluded.clear();
+
+        if (search.stopFlag)
+            break;
+
+        // a later line can beat an earlier one once its window is searched
+        std::stable_sort(current.begin(), current.end(),
+            [](const PVLine& a, const PVLine& b) { return a.score > b.score; });
+
+#ifdef CHESS_STATS
+        uint64_t searched = stats.nodes + stats.qnodes;
+        if (lastIteration)
+            stats.branchingFactor.push_back(double(searched - iterationStart) / lastIteration);
+        lastIteration = searched - iterationStart;
+        iterationStart = searched;
+#endif
+
+        completedDepth = depth;
+        lines = current;
+        bestScore = lines[0].score;
+        rootPv = lines[0].pv;
+
+        if (id != 0)
+            continue;
+
+        uint64_t elapsed = get_time_ms() - search.startTime;
+        if (search.onInfo) {
+            PawnTableStats pawns = pawnTableStats();
+            uint64_t probes = pawns.probes - pawnStart.probes;
+
+            SearchInfo info;
+            info.depth = depth;
+            info.nodes = search.totalNodes();
+            info.time = elapsed;
+            info.hashfull = search.tt.hashfull();
+            info.tbHits = search.totalTbHits();
+            info.pawnHitRate = probes ? double(pawns.hits - pawnStart.hits) / probes : 0.0;
+            for (int i = 0; i < multiPV; i++) {
+                info.multiPV = i + 1;
+                info.score = lines[i].score;
+                info.pv = lines[i].pv;
+                search.onInfo(info);
+            }
+        }
+
+        // don't start an iteration we are unlikely to finish
+        if (!search.ponderFlag && search.softLimit && (int64_t)elapsed >= search.softLimit)
+            break;
+    }
+
+    if (id == 0)
+        finish();
+}
+
+// main thread: wait out ponder / infinite, collect the helpers and report
+void SearchWorker::finish() {
+
+    while ((search.ponderFlag || search.limits.infinite) && !search.stopFlag)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    search.stopFlag = true;
+    {
+        std::unique_lock<std::mutex> lock(search.mutex);
+        search.cv.wait(lock, [this] { return search.running == 1; });
+    }
+
+    SearchResult& result = search.result;
+    result.bestMove = rootPv.empty() ? 0 : rootPv[0];
+    result.ponderMove = rootPv.size() > 1 ? rootPv[1] : 0;
+    result.score = bestScore;
+    result.depth = completedDepth;
+    result.nodes = search.totalNodes();
+    result.lines = lines;
+
+    // stopped before the first iteration completed, any legal move beats none
+    if (!result.bestMove && !search.rootMoves.empty()) {
+        result.bestMove = search.rootMoves[0];
+    }
+    else if (!result.bestMove) {
+        MoveList legal = board.legalMoves();
+        if (!legal.empty())
+            result.bestMove = legal[0];
+    }
+
+    if (search.onBestMove)
+        search.onBestMove(result);
+}
+
+// search controller //
+Search::Search()
+    : stopFlag(false), ponderFlag(false), startTime(0), softLimit(0), hardLimit(0), result{}, running(0)
+{
+    setThreads(1);
+}
+
+Search::~Search() {
+    stop();
+    wait();
+    workers.clear();
+}
+
+void Search::setThreads(int count) {
+    wait();
+    workers.clear();
+    for (int id = 0; id < std::max(count, 1); id++)
+        workers.push_back(std::make_unique<SearchWorker>(*this, id));
+}
+
+void Search::setHash(size_t megabytes) {
+    wait();
+    tt.resize(megabytes);
+}
+
+void Search::clear() {
+    wait();
+    tt.clear();
+    for (auto& worker : workers)
+        memset(worker->history, 0, sizeof(worker->history));
+    clearPawnTable();
+}
+
+void Search::initTimeLimits(int side) {
+    const int64_t overhead = 20;
+    softLimit = hardLimit = 0;
+
+    if (limits.movetime) {
+        softLimit = hardLimit = std::max<int64_t>(limits.movetime - overhead, 1);
+    }
+    else if (limits.time[side]) {
+        int64_t time = limits.time[side];
+        int movestogo = limits.movestogo ? limits.movestogo : 30;
+        int64_t base = time / movestogo + limits.inc[side] * 3 / 4;
+
+        // soft limit: no new iteration, hard limit: abort the running one
+        softLimit = std::max<int64_t>(base / 2, 1);
+        hardLimit = std::max<int64_t>(std::min(base * 3, time - overhead), 1);
+        softLimit = std::min(softLimit, hardLimit);
+    }
+}
+
+uint64_t Search::totalNodes() const {
+    uint64_t nodes = 0;
+    for (const auto& worker : workers)
+        nodes += worker->nodes.load(std::memory_order_relaxed);
+    return nodes;
+}
+
+// counters of the last search, worker 0 first; read them once the search is done
+std::vector<SearchStats> Search::threadStats() const {
+    std::vector<SearchStats> stats;
+    for (const auto& worker : workers)
+        stats.push_back(worker->stats);
+    return stats;
+}
+
+SearchStats Search::stats() const {
+    SearchStats total;
+    for (const auto& worker : workers)
+        total += worker->stats;
+    return total;
+}
+
+uint64_t Search::totalTbHits() const {
+    uint64_t hits = 0;
+    for (const auto& worker : workers)
+        hits += worker->tbHits.load(std::memory_order_relaxed);
+    return hits;
+}
+
+void Search::start(const Board& board, const SearchLimits& newLimits) {
+    wait();
+
+    limits = newLimits;
+    stopFlag = false;
+    ponderFlag = limits.ponder;
+    startTime = get_time_ms();
+    initTimeLimits(board.getSide());
+
+    // in tablebase positions only the moves that keep the result are searched
+    rootMoves.clear();
+    if (syzygyMaxPieces() && countBits(board.getOccupancy(All)) <= syzygyMaxPieces()) {
+        Board root = board;
+        MoveList legal = root.legalMoves();
+        if (syzygyFilterRootMoves(root, legal))
+            rootMoves.assign(legal.moves, legal.moves + legal.size());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& worker : workers) {
+            worker->board = board;
+            worker->nodes = 0;
+            worker->tbHits = 0;
+            worker->stats = SearchStats();
+            worker->searching = true;
+        }
+        running = static_cast<int>(workers.size());
+    }
+    cv.notify_all();
+}
+
+void Search::stop() {
+    stopFlag = true;
+}
+
+// the opponent played the expected move, the clock is running from now on
+void Search::ponderhit() {
+    startTime = get_time_ms();
+    ponderFlag = false;
+}
+
+void Search::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return running == 0; });
+}
+
+SearchResult Search::go(const Board& board, const SearchLimits& newLimits) {
+    start(board, newLimits);
+    wait();
+    return result;
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "chess.h"
+#include "stats.h"
+
+constexpr int MAX_PLY = 128;
+constexpr int INF_SCORE = 32000;
+constexpr int MATE_SCORE = 31000;
+constexpr int MATE_BOUND = MATE_SCORE - MAX_PLY;
+
+// tablebase wins rank below every mate, and like mates are stored relative to the node
+constexpr int TB_WIN_SCORE = MATE_BOUND - 1;
+constexpr int TB_WIN_BOUND = TB_WIN_SCORE - MAX_PLY;
+
+enum TTFlag : uint8_t { TT_NONE, TT_EXACT, TT_UPPER, TT_LOWER };
+
+struct TTData {
+    Move move;
+    int score;
+    int depth;
+    int flag;
+};
+
+// shared between search threads; the key is stored xor'ed with the data so a
+// torn write from another thread is detected as a miss instead of a bad move
+class TranspositionTable {
+public:
+    TranspositionTable();
+
+    void resize(size_t megabytes);
+    void clear();
+
+    bool probe(uint64_t key, TTData& data) const;
+    void store(uint64_t key, Move move, int score, int depth, int flag);
+
+    // permille of used entries, sampled from the first thousand
+    int hashfull() const;
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> key;
+        std::atomic<uint64_t> data;
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    size_t count;
+};
+
+struct SearchLimits {
+    int depth = MAX_PLY - 1;
+    uint64_t nodes = 0;
+    int64_t movetime = 0;
+    int64_t time[2] = { 0, 0 };   // remaining clock [color] in ms
+    int64_t inc[2] = { 0, 0 };
+    int movestogo = 0;
+    int multiPV = 1;              // best root moves searched, each with its own PV
+    bool infinite = false;
+    bool ponder = false;
+};
+
+// one of the multiPV best root moves
+struct PVLine {
+    int score = 0;
+    int depth = 0;
+    std::vector<Move> pv;
+};
+
+// reported after every completed iteration
+struct SearchInfo {
+    int depth;
+    int multiPV;    // 1-based line number, lines are reported best first
+    int score;
+    uint64_t nodes;
+    uint64_t time;
+    int hashfull;
+    uint64_t tbHits;
+    double pawnHitRate;
+    std::vector<Move> pv;
+};
+
+struct SearchResult {
+    Move bestMove;
+    Move ponderMove;
+    int score;
+    int depth;
+    uint64_t nodes;
+    std::vector<PVLine> lines;   // best first, at most limits.multiPV
+};
+
+class SearchWorker;
+
+// iterative deepening alpha-beta on a pool of persistent threads (lazy SMP);
+// worker 0 manages time and reports, the others only fill the shared table
+class Search {
+public:
+    Search();
+    ~Search();
+
+    // these wait for a running search to end, stop an infinite or pondering one first
+    void setThreads(int count);
+    void setHash(size_t megabytes);
+    void clear();
+
+    // start searching in the background, onBestMove is called when done
+    void start(const Board& board, const SearchLimits& limits);
+    void stop();
+    void ponderhit();
+    void wait();
+
+    // blocking search
+    SearchResult go(const Board& board, const SearchLimits& limits);
+
+    // search statistics (all zero unless built with CHESS_STATS)
+    std::vector<SearchStats> threadStats() const;
+    SearchStats stats() const;
+
+    std::function<void(const SearchInfo&)> onInfo;
+    std::function<void(const SearchResult&)> onBestMove;
+
+private:
+    friend class SearchWorker;
+
+    TranspositionTable tt;
+    std::vector<std::unique_ptr<SearchWorker>> workers;
+
+    SearchLimits limits;
+    std::vector<Move> rootMoves;   // tablebase filtered root moves, empty = all legal
+    std::atomic<bool> stopFlag;
+    std::atomic<bool> ponderFlag;
+    std::atomic<uint64_t> startTime;
+    int64_t softLimit;
+    int64_t hardLimit;
+    SearchResult result;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    int running;
+
+    void initTimeLimits(int side);
+    uint64_t totalNodes() const;
+    uint64_t totalTbHits() const;
+};
+
+// score -> "cp x" / "mate x" for uci output
+std::string scoreToString(int score);
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+#include "packed.h"
+#include "search.h"
+#include "selfplay.h"
+#include "syzygy.h"
+
+namespace {
+
+// openings drawn again when their random moves end the game, before playing it anyway
+constexpr int OPENING_ATTEMPTS = 100;
+
+struct Game {
+    std::vector<PackedPosition> records;
+    int result;          // white's point of view
+    bool adjudicated;
+    bool error;
+};
+
+// the lines of the file that parse as EPD positions
+bool loadOpenings(const std::string& path, std::vector<std::string>& openings) {
+    MappedFile file;
+    if (!file.open(path, true))
+        return false;
+    std::string_view text(reinterpret_cast<const char*>(file.data), file.size);
+
+    Board board;
+    std::vector<EPDOperation> operations;
+    for (size_t pos = 0; pos < text.size();) {
+        size_t end = text.find('\n', pos);
+        end = end == std::string_view::npos ? text.size() : end;
+        std::string_view line = text.substr(pos, end - pos);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        if (!line.empty() && board.parseEPD(line, operations) == FEN_OK)
+            openings.emplace_back(line);
+        pos = end + 1;
+    }
+    return !openings.empty();
+}
+
+void playOpening(const SelfPlayConfig& config, const std::vector<std::string>& openings,
+    std::mt19937_64& rng, Board& board) {
+    std::vector<EPDOperation> operations;
+    for (int attempt = 0; attempt < OPENING_ATTEMPTS; attempt++) {
+        if (openings.empty())
+            board.parseFEN(START_FEN);
+        else
+            board.parseEPD(openings[rng() % openings.size()], operations);
+
+        bool playable = true;
+        for (int ply = 0; ply < config.randomPlies && playable; ply++) {
+            MoveList legal = board.legalMoves();
+            if (legal.empty())
+                playable = false;
+            else
+                board.makeMove(legal[rng() % legal.size()], ALL_MOVES);
+        }
+        if (playable && board.status() == ONGOING)
+            return;
+    }
+}
+
+void playGame(const SelfPlayConfig& config, const std::vector<std::string>& openings, size_t index,
+    Search* search, const SelfPlayPolicy& policy, Game& game) {
+    game.records.clear();
+    game.result = 0;
+    game.adjudicated = false;
+    game.error = false;
+
+    // seeded by the game so the openings do not depend on which worker plays them
+    std::mt19937_64 rng(config.seed ^ (index + 1) * 0x9E3779B97F4A7C15ULL);
+    Board board;
+    playOpening(config, openings, rng, board);
+    int firstSide = board.getSide();
+
+    SearchLimits limits;
+    if (config.depth)
+        limits.depth = std::min(config.depth, MAX_PLY - 1);
+    limits.nodes = config.depth || config.nodes ? config.nodes : SELFPLAY_DEFAULT_NODES;
+
+    int resignCount = 0, resignSign = 0, drawCount = 0;
+    for (int ply = 0;; ply++) {
+        int side = board.getSide();
+        GameStatus status = board.status();
+        if (status != ONGOING) {
+            game.result = status != CHECKMATE ? 0 : side == White ? -1 : 1;
+            break;
+        }
+        if (config.maxPlies && ply >= config.maxPlies) {
+            game.adjudicated = true;
+            break;
+        }
+        if (config.tablebases && syzygyMaxPieces() && countBits(board.getOccupancy(All)) <= syzygyMaxPieces()) {
+            bool ok;
+            WDLScore wdl = syzygyProbeWDL(board, ok);
+            if (ok) {
+                int result = wdl == WDL_WIN ? 1 : wdl == WDL_LOSS ? -1 : 0;
+                game.result = side == White ? result : -result;
+                game.adjudicated = true;
+                break;
+            }
+        }
+
+        Move move;
+        int score = 0;
+        if (policy) {
+            move = policy(board, score);
+            MoveStore m(move);
+            if (!move || board.findMove(m.getSource(), m.getTarget(), m.getPromoted()) != move) {
+                game.error = true;
+                return;
+            }
+        }
+        else {
+            SearchResult result = search->go(board, limits);
+            move = result.bestMove;
+            score = result.score;
+        }
+        game.records.push_back(packPosition(board, score, move, 0));
+        board.makeMove(move, ALL_MOVES);
+
+        // both sides have to agree on the winner, the score is the side to move's
+        int whiteScore = side == White ? score : -score;
+        if (std::abs(score) >= config.resignScore) {
+            int sign = whiteScore > 0 ? 1 : -1;
+            resignCount = sign == resignSign ? resignCount + 1 : 1;
+            resignSign = sign;
+        }
+        else {
+            resignCount = 0;
+        }
+        drawCount = ply >= config.drawMinPly && std::abs(score) <= config.drawScore ? drawCount + 1 : 0;
+
+        if (config.resignPlies && resignCount >= config.resignPlies) {
+            game.result = resignSign;
+            game.adjudicated = true;
+            break;
+        }
+        if (config.drawPlies && drawCount >= config.drawPlies) {
+            game.adjudicated = true;
+            break;
+        }
+    }
+
+    // records alternate sides from the first one on
+    for (size_t i = 0; i < game.records.size(); i++) {
+        int side = firstSide ^ static_cast<int>(i & 1);
+        game.records[i].result = static_cast<int8_t>(side == White ? game.result : -game.result);
+    }
+}
+
+}
+
+bool selfPlay(const SelfPlayConfig& config, const std::string& path, SelfPlayStats* stats,
+    const SelfPlayPolicy& policy) {
+    if (stats)
+        *stats = SelfPlayStats();
+    std::vector<std::string> openings;
+    if (!config.openings.empty() && !loadOpenings(config.openings, openings))
+        return false;
+    PackedWriter writer;
+    if (!writer.open(path))
+        return false;
+
+    SelfPlayStats total;
+    std::mutex mutex;
+    std::atomic<size_t> next{ 0 };
+    std::atomic<bool> abort{ false };
+    std::exception_ptr error;
+
+    auto work = [&]() {
+        try {
+            std::unique_ptr<Search> search;
+            if (!policy) {
+                search = std::make_unique<Search>();
+                search->setHash(config.hash);
+            }
+            Game game;
+            while (!abort) {
+                size_t index = next++;
+                if (index >= config.games)
+                    break;
+                playGame(config, openings, index, search.get(), policy, game);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                total.games++;
+                if (game.error) {
+                    total.errors++;
+                    continue;
+                }
+                for (const PackedPosition& record : game.records)
+                    if (!writer.write(record))
+                        abort = true;
+                total.whiteWins += game.result > 0;
+                total.blackWins += game.result < 0;
+                total.draws += game.result == 0;
+                total.adjudicated += game.adjudicated;
+            }
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error)
+                error = std::current_exception();
+            abort = true;
+        }
+    };
+
+    // the calling thread is one of the workers
+    size_t threads = config.threads > 0 ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max<size_t>(std::min(threads, config.games), 1);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; i++)
+        workers.emplace_back(work);
+    work();
+    for (std::thread& worker : workers)
+        worker.join();
+
+    total.records = writer.count();
+    if (stats)
+        *stats = total;
+    bool ok = writer.close();
+    if (error)
+        std::rethrow_exception(error);
+    return ok;
+}
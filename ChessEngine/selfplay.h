@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "chess.h"
+
+// Self-play data generation: games are played on worker threads, each with its own
+// single-threaded search, and every game is written as packed records (one per position
+// with the move played, its score and the game result) as soon as it ends
+
+constexpr uint64_t SELFPLAY_DEFAULT_NODES = 5000;
+
+struct SelfPlayConfig {
+    size_t games = 1;
+    int threads = 0;               // 0 = one per hardware thread
+    int depth = 0;                 // fixed search per move, depth and / or nodes; with
+    uint64_t nodes = 0;            // neither set SELFPLAY_DEFAULT_NODES nodes
+    size_t hash = 16;              // megabytes per worker
+
+    // openings: a random line of the EPD file (the standard start position without one),
+    // followed by randomPlies uniformly random moves; records start after them
+    std::string openings;
+    int randomPlies = 8;
+    uint64_t seed = 0;
+
+    // adjudication, maxPlies / resignPlies / drawPlies at 0 turn a rule off
+    int maxPlies = 400;            // draw once the game is this long
+    int resignScore = 1500;        // |score| at least this for resignPlies plies in a row
+    int resignPlies = 6;
+    int drawScore = 10;            // |score| at most this for drawPlies plies in a row,
+    int drawPlies = 12;            // from drawMinPly on
+    int drawMinPly = 80;
+    bool tablebases = true;        // probe the loaded Syzygy tables
+};
+
+struct SelfPlayStats {
+    size_t games = 0;
+    size_t records = 0;
+    size_t whiteWins = 0;
+    size_t blackWins = 0;
+    size_t draws = 0;
+    size_t adjudicated = 0;        // games ended by one of the adjudication rules
+    size_t errors = 0;             // games dropped for an illegal policy move
+};
+
+// replaces the search: returns the move to play and sets score (centipawns, side to move's
+// point of view); called concurrently from the worker threads, the board must be left as
+// it is. A move that is not legal drops the game
+using SelfPlayPolicy = std::function<Move(Board& board, int& score)>;
+
+// false if the output or opening file can not be opened, or the opening file holds no
+// valid position. Records are written in the order games end; an exception thrown by the
+// policy stops every worker and passes on once they are done
+bool selfPlay(const SelfPlayConfig& config, const std::string& path, SelfPlayStats* stats = nullptr,
+    const SelfPlayPolicy& policy = nullptr);
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// search statistics, counted per thread when built with -DCHESS_STATS; otherwise
+// the STATS_INC sites compile to nothing and every counter stays zero
+
+#ifdef CHESS_STATS
+constexpr bool STATS_ENABLED = true;
+#define STATS_INC(counter) (stats.counter++)
+#else
+constexpr bool STATS_ENABLED = false;
+#define STATS_INC(counter) ((void)0)
+#endif
+
+struct SearchStats {
+    uint64_t nodes = 0;               // negamax nodes
+    uint64_t qnodes = 0;              // quiescence nodes
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;
+    uint64_t ttCutoffs = 0;
+    uint64_t betaCutoffs = 0;
+    uint64_t firstMoveCutoffs = 0;    // of betaCutoffs, by the first move tried
+    uint64_t nullMoveTries = 0;
+    uint64_t nullMoveCutoffs = 0;
+    uint64_t lmrReductions = 0;       // reduced searches
+    uint64_t lmrResearches = 0;       // of those, searched again at full depth
+    std::vector<double> branchingFactor;   // nodes of each iteration / nodes of the previous one
+
+    // sum of the counters, branching factors stay those of the first thread (the main one)
+    SearchStats& operator+=(const SearchStats& other) {
+        nodes += other.nodes;
+        qnodes += other.qnodes;
+        ttProbes += other.ttProbes;
+        ttHits += other.ttHits;
+        ttCutoffs += other.ttCutoffs;
+        betaCutoffs += other.betaCutoffs;
+        firstMoveCutoffs += other.firstMoveCutoffs;
+        nullMoveTries += other.nullMoveTries;
+        nullMoveCutoffs += other.nullMoveCutoffs;
+        lmrReductions += other.lmrReductions;
+        lmrResearches += other.lmrResearches;
+        if (branchingFactor.empty())
+            branchingFactor = other.branchingFactor;
+        return *this;
+    }
+};
@@ -0,0 +1,967 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "chess.h"
+#include "logger.h"
+#include "mapped_file.h"
+#include "syzygy.h"
+
+// table file layout follows the reference prober by R. de Man: every table is a
+// list of Huffman-compressed blocks of "recursive pairing" symbols, indexed by a
+// canonical encoding of the piece squares (kings / leading pawns mirrored into a
+// reference triangle, remaining groups as combinations of the free squares)
+
+namespace {
+
+enum TBFlag : uint8_t { TB_STM = 1, TB_MAPPED = 2, TB_WIN_PLIES = 4, TB_LOSS_PLIES = 8, TB_WIDE = 16, TB_SINGLE_VALUE = 128 };
+
+enum ProbeState { PROBE_FAIL, PROBE_OK, PROBE_CHANGE_STM, PROBE_ZEROING_BEST_MOVE };
+
+const uint8_t WDL_MAGIC[4] = { 0x71, 0xE8, 0x23, 0x5D };
+const uint8_t DTZ_MAGIC[4] = { 0xD7, 0x66, 0x0C, 0xA5 };
+
+// file data is little endian except for the compressed bit stream
+uint16_t readLE16(const uint8_t* p) { return uint16_t(p[0] | p[1] << 8); }
+uint32_t readLE32(const uint8_t* p) { return p[0] | p[1] << 8 | p[2] << 16 | uint32_t(p[3]) << 24; }
+uint32_t readBE32(const uint8_t* p) { return uint32_t(p[0]) << 24 | p[1] << 16 | p[2] << 8 | p[3]; }
+uint64_t readBE64(const uint8_t* p) { return uint64_t(readBE32(p)) << 32 | readBE32(p + 4); }
+
+int rankOf(int square) { return square >> 3; }
+int fileOf(int square) { return square & 7; }
+int offA1H8(int square) { return rankOf(square) - fileOf(square); }
+int signOf(int value) { return (value > 0) - (value < 0); }
+
+int popLSB(Bitboard& bitboard) {
+    int square = getLSBIndex(bitboard);
+    bitboard &= bitboard - 1;
+    return square;
+}
+
+// encoding tables //
+int mapB1H1H7[64];         // squares below the a1-h8 diagonal -> 0..27
+int mapA1D1D4[64];         // a1-d1-d4 triangle -> 0..9, diagonal last
+int mapKK[10][64];         // 462 legal king pairs with the first king in the triangle
+int binomial[6][64];       // binomial[k][n] = n choose k
+int mapPawns[64];          // a2-h7 -> 0..47, the leading pawn has the highest value
+int leadPawnIdx[6][64];    // [leading pawns][square]
+int leadPawnsSize[6][4];   // [leading pawns][file]
+
+void initEncodingTables() {
+
+    int code = 0;
+    for (int s = a1; s <= h8; s++)
+        if (offA1H8(s) < 0)
+            mapB1H1H7[s] = code++;
+
+    std::vector<int> diagonal;
+    code = 0;
+    for (int s = a1; s <= d4; s++) {
+        if (offA1H8(s) < 0 && fileOf(s) <= 3)
+            mapA1D1D4[s] = code++;
+        else if (!offA1H8(s) && fileOf(s) <= 3)
+            diagonal.push_back(s);
+    }
+    for (int s : diagonal)
+        mapA1D1D4[s] = code++;
+
+    // if the first king is on the diagonal the second one can't be above it,
+    // pairs with both kings on the diagonal are encoded last
+    std::vector<std::pair<int, int>> bothOnDiagonal;
+    code = 0;
+    for (int idx = 0; idx < 10; idx++)
+        for (int s1 = a1; s1 <= d4; s1++) {
+            if (mapA1D1D4[s1] != idx || (!idx && s1 != b1))
+                continue;
+
+            for (int s2 = a1; s2 <= h8; s2++) {
+                bool adjacent = std::abs(fileOf(s1) - fileOf(s2)) <= 1 && std::abs(rankOf(s1) - rankOf(s2)) <= 1;
+                if (adjacent || (!offA1H8(s1) && offA1H8(s2) > 0))
+                    continue;
+                if (!offA1H8(s1) && !offA1H8(s2))
+                    bothOnDiagonal.emplace_back(idx, s2);
+                else
+                    mapKK[idx][s2] = code++;
+            }
+        }
+    for (auto& [idx, s2] : bothOnDiagonal)
+        mapKK[idx][s2] = code++;
+
+    binomial[0][0] = 1;
+    for (int n = 1; n < 64; n++)
+        for (int k = 0; k < 6 && k <= n; k++)
+            binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+
+    // each rank step of the leading pawn removes two squares (own file and its mirror)
+    int availableSquares = 47;
+    for (int leadPawns = 1; leadPawns <= 5; leadPawns++)
+        for (int file = 0; file < 4; file++) {
+            int idx = 0;
+            for (int rank = 1; rank <= 6; rank++) {
+                int square = rank * 8 + file;
+                if (leadPawns == 1) {
+                    mapPawns[square] = availableSquares--;
+                    mapPawns[square ^ 7] = availableSquares--;
+                }
+                leadPawnIdx[leadPawns][square] = idx;
+                idx += binomial[leadPawns - 1][mapPawns[square]];
+            }
+            leadPawnsSize[leadPawns][file] = idx;
+        }
+}
+
+bool pawnsCompare(int a, int b) {
+    return mapPawns[a] < mapPawns[b];
+}
+
+// one compressed sub-table (per side to move and leading pawn file) //
+struct PairsData {
+    uint8_t flags = 0;
+    int maxSymLen = 0;
+    int minSymLen = 0;            // or the value of a single value table
+    uint32_t blocksNum = 0;
+    uint64_t sizeofBlock = 0;
+    uint64_t span = 0;            // values between two sparse index entries
+    const uint8_t* lowestSym = nullptr;
+    const uint8_t* btree = nullptr;          // symbol -> (left, right), 12 bits each
+    const uint8_t* blockLength = nullptr;    // uint16 per block
+    size_t blockLengthSize = 0;
+    const uint8_t* sparseIndex = nullptr;    // uint32 block + uint16 offset per entry
+    size_t sparseIndexSize = 0;
+    const uint8_t* data = nullptr;
+    std::vector<uint64_t> base64;            // lowest left-aligned code per symbol length
+    std::vector<uint8_t> symlen;             // number of values - 1 a symbol expands to
+    int pieces[SYZYGY_MAX_PIECES] = {};
+    uint64_t groupIdx[SYZYGY_MAX_PIECES + 1] = {};
+    int groupLen[SYZYGY_MAX_PIECES + 1] = {};
+    uint16_t mapIdx[4] = {};                 // dtz: offsets of the value maps per wdl
+
+    int symLeft(int sym) const { return ((btree[3 * sym + 1] & 0xF) << 8) | btree[3 * sym]; }
+    int symRight(int sym) const { return (btree[3 * sym + 2] << 4) | (btree[3 * sym + 1] >> 4); }
+};
+
+struct TBTable {
+    bool dtz = false;
+    std::string path;
+    uint64_t key = 0;     // material with the stronger side as white
+    uint64_t key2 = 0;    // colors swapped
+    int pieceCount = 0;
+    bool hasPawns = false;
+    bool hasUniquePieces = false;
+    int pawnCount[2] = {};   // [leading color, other]
+
+    std::atomic<bool> ready{ false };
+    std::mutex mutex;        // guards the lazy mapping
+    bool failed = false;
+    MappedFile file;
+    const uint8_t* map = nullptr;   // dtz value maps
+    PairsData items[2][4];          // [side to move][leading pawn file]
+
+    PairsData* get(int stm, int file) { return &items[dtz ? 0 : stm][hasPawns ? file : 0]; }
+};
+
+// piece counts [color][piece] packed in 4 bits each
+uint64_t materialKey(const int counts[2][6], bool swapColors) {
+    uint64_t key = 0;
+    for (int color = White; color <= Black; color++)
+        for (int piece = Pawn; piece <= King; piece++)
+            key |= uint64_t(counts[color ^ swapColors][piece]) << (4 * (6 * color + piece));
+    return key;
+}
+
+std::vector<std::unique_ptr<TBTable>> tables;
+std::unordered_map<uint64_t, std::pair<TBTable*, TBTable*>> tableIndex;   // key -> wdl, dtz
+std::atomic<int> maxPieces{ 0 };
+
+// probes share the registry, syzygyInit replaces it exclusively
+std::shared_mutex registryMutex;
+
+// table layout //
+int setSymlen(PairsData* d, int sym, std::vector<bool>& visited) {
+    visited[sym] = true;
+    int right = d->symRight(sym);
+    if (right == 0xFFF)
+        return 0;
+
+    int left = d->symLeft(sym);
+    if (!visited[left])
+        d->symlen[left] = setSymlen(d, left, visited);
+    if (!visited[right])
+        d->symlen[right] = setSymlen(d, right, visited);
+    return d->symlen[left] + d->symlen[right] + 1;
+}
+
+// split the piece sequence into groups and compute the index multiplier of each
+void setGroups(TBTable& t, PairsData* d, const int order[2], int file) {
+
+    int n = 0, firstLen = t.hasPawns ? 0 : t.hasUniquePieces ? 3 : 2;
+    d->groupLen[n] = 1;
+
+    for (int i = 1; i < t.pieceCount; i++) {
+        if (--firstLen > 0 || d->pieces[i] == d->pieces[i - 1])
+            d->groupLen[n]++;
+        else
+            d->groupLen[++n] = 1;
+    }
+    d->groupLen[++n] = 0;
+
+    bool pawnsBothSides = t.hasPawns && t.pawnCount[1];
+    int next = pawnsBothSides ? 2 : 1;
+    int freeSquares = 64 - d->groupLen[0] - (pawnsBothSides ? d->groupLen[1] : 0);
+    uint64_t idx = 1;
+
+    // order[0] is the position of the leading group, order[1] of the other side's pawns
+    for (int k = 0; next < n || k == order[0] || k == order[1]; k++) {
+        if (k == order[0]) {
+            d->groupIdx[0] = idx;
+            idx *= t.hasPawns ? leadPawnsSize[d->groupLen[0]][file] : t.hasUniquePieces ? 31332 : 462;
+        }
+        else if (k == order[1]) {
+            d->groupIdx[1] = idx;
+            idx *= binomial[d->groupLen[1]][48 - d->groupLen[0]];
+        }
+        else {
+            d->groupIdx[next] = idx;
+            idx *= binomial[d->groupLen[next]][freeSquares];
+            freeSquares -= d->groupLen[next++];
+        }
+    }
+    d->groupIdx[n] = idx;
+}
+
+const uint8_t* setSizes(PairsData* d, const uint8_t* data) {
+
+    d->flags = *data++;
+    if (d->flags & TB_SINGLE_VALUE) {
+        d->minSymLen = *data++;
+        return data;
+    }
+
+    int groups = 0;
+    while (d->groupLen[groups])
+        groups++;
+    uint64_t tableSize = d->groupIdx[groups];
+
+    d->sizeofBlock = 1ULL << *data++;
+    d->span = 1ULL << *data++;
+    d->sparseIndexSize = (tableSize + d->span - 1) / d->span;
+    int padding = *data++;
+    d->blocksNum = readLE32(data);
+    data += 4;
+    d->blockLengthSize = d->blocksNum + padding;
+    d->maxSymLen = *data++;
+    d->minSymLen = *data++;
+    d->lowestSym = data;
+
+    // canonical Huffman: longer codes have lower values, so base64[len] is the
+    // lowest code of each length left-aligned in 64 bits
+    d->base64.assign(d->maxSymLen - d->minSymLen + 1, 0);
+    for (int i = static_cast<int>(d->base64.size()) - 2; i >= 0; i--)
+        d->base64[i] = (d->base64[i + 1] + readLE16(d->lowestSym + 2 * i) - readLE16(d->lowestSym + 2 * (i + 1))) / 2;
+    for (size_t i = 0; i < d->base64.size(); i++)
+        d->base64[i] <<= 64 - i - d->minSymLen;
+
+    data += d->base64.size() * 2;
+    d->symlen.assign(readLE16(data), 0);
+    data += 2;
+    d->btree = data;
+
+    std::vector<bool> visited(d->symlen.size());
+    for (size_t sym = 0; sym < d->symlen.size(); sym++)
+        if (!visited[sym])
+            d->symlen[sym] = static_cast<uint8_t>(setSymlen(d, static_cast<int>(sym), visited));
+
+    return data + d->symlen.size() * 3 + (d->symlen.size() & 1);
+}
+
+const uint8_t* setDtzMap(TBTable& t, const uint8_t* data, int maxFile) {
+    t.map = data;
+
+    for (int file = 0; file <= maxFile; file++) {
+        PairsData* d = t.get(0, file);
+        if (!(d->flags & TB_MAPPED))
+            continue;
+
+        if (d->flags & TB_WIDE) {
+            data += reinterpret_cast<uintptr_t>(data) & 1;
+            for (int i = 0; i < 4; i++) {
+                d->mapIdx[i] = static_cast<uint16_t>((data - t.map) / 2 + 1);
+                data += 2 * readLE16(data) + 2;
+            }
+        }
+        else {
+            for (int i = 0; i < 4; i++) {
+                d->mapIdx[i] = static_cast<uint16_t>(data - t.map + 1);
+                data += *data + 1;
+            }
+        }
+    }
+    return data + (reinterpret_cast<uintptr_t>(data) & 1);
+}
+
+// parse the header of a freshly mapped table, data points past the magic
+bool setupTable(TBTable& t, const uint8_t* data) {
+
+    enum { SPLIT = 1, HAS_PAWNS = 2 };
+    if (bool(*data & HAS_PAWNS) != t.hasPawns || bool(*data & SPLIT) != (t.key != t.key2))
+        return false;
+    data++;
+
+    int sides = !t.dtz && t.key != t.key2 ? 2 : 1;
+    int maxFile = t.hasPawns ? 3 : 0;
+    bool pawnsBothSides = t.hasPawns && t.pawnCount[1];
+
+    for (int file = 0; file <= maxFile; file++) {
+        int order[2][2] = {
+            { *data & 0xF, pawnsBothSides ? *(data + 1) & 0xF : 0xF },
+            { *data >> 4, pawnsBothSides ? *(data + 1) >> 4 : 0xF }
+        };
+        data += 1 + pawnsBothSides;
+
+        for (int k = 0; k < t.pieceCount; k++, data++)
+            for (int i = 0; i < sides; i++)
+                t.get(i, file)->pieces[k] = i ? *data >> 4 : *data & 0xF;
+
+        for (int i = 0; i < sides; i++)
+            setGroups(t, t.get(i, file), order[i], file);
+    }
+    data += reinterpret_cast<uintptr_t>(data) & 1;
+
+    for (int file = 0; file <= maxFile; file++)
+        for (int i = 0; i < sides; i++)
+            data = setSizes(t.get(i, file), data);
+
+    if (t.dtz)
+        data = setDtzMap(t, data, maxFile);
+
+    for (int file = 0; file <= maxFile; file++)
+        for (int i = 0; i < sides; i++) {
+            PairsData* d = t.get(i, file);
+            d->sparseIndex = data;
+            data += d->sparseIndexSize * 6;
+        }
+
+    for (int file = 0; file <= maxFile; file++)
+        for (int i = 0; i < sides; i++) {
+            PairsData* d = t.get(i, file);
+            d->blockLength = data;
+            data += d->blockLengthSize * 2;
+        }
+
+    for (int file = 0; file <= maxFile; file++)
+        for (int i = 0; i < sides; i++) {
+            PairsData* d = t.get(i, file);
+            data += (64 - (reinterpret_cast<uintptr_t>(data) & 63)) & 63;
+            d->data = data;
+            data += d->blocksNum * d->sizeofBlock;
+        }
+
+    return data <= t.file.data + t.file.size;
+}
+
+// map the file on first use, concurrent probes wait for the first one
+bool mapTable(TBTable& t) {
+    if (t.ready.load(std::memory_order_acquire))
+        return true;
+
+    std::lock_guard<std::mutex> lock(t.mutex);
+    if (t.ready.load(std::memory_order_relaxed))
+        return true;
+    if (t.failed)
+        return false;
+
+    const uint8_t* magic = t.dtz ? DTZ_MAGIC : WDL_MAGIC;
+    if (!t.file.open(t.path) || t.file.size % 64 != 16 || memcmp(t.file.data, magic, 4)
+        || !setupTable(t, t.file.data + 4)) {
+        logger.error("corrupt or unreadable tablebase: " + t.path);
+        t.file.close();
+        t.failed = true;
+        return false;
+    }
+
+    t.ready.store(true, std::memory_order_release);
+    return true;
+}
+
+// value at a table index //
+int decompressPairs(const PairsData* d, uint64_t idx) {
+
+    if (d->flags & TB_SINGLE_VALUE)
+        return d->minSymLen;
+
+    // the sparse index gives the block and offset of every span-th value,
+    // walk the block lengths from there to the block holding idx
+    uint32_t k = static_cast<uint32_t>(idx / d->span);
+    const uint8_t* entry = d->sparseIndex + 6 * static_cast<size_t>(k);
+    uint32_t block = readLE32(entry);
+    int offset = readLE16(entry + 4);
+    offset += static_cast<int>(idx % d->span) - static_cast<int>(d->span / 2);
+
+    while (offset < 0)
+        offset += readLE16(d->blockLength + 2 * --block) + 1;
+    while (offset > readLE16(d->blockLength + 2 * block))
+        offset -= readLE16(d->blockLength + 2 * block++) + 1;
+
+    // decode symbols until the one covering offset
+    const uint8_t* ptr = d->data + uint64_t(block) * d->sizeofBlock;
+    uint64_t buf64 = readBE64(ptr);
+    ptr += 8;
+    int buf64Size = 64;
+    int sym;
+
+    while (true) {
+        int len = 0;
+        while (buf64 < d->base64[len])
+            len++;
+
+        sym = static_cast<int>((buf64 - d->base64[len]) >> (64 - len - d->minSymLen));
+        sym += readLE16(d->lowestSym + 2 * len);
+
+        if (offset < d->symlen[sym] + 1)
+            break;
+
+        offset -= d->symlen[sym] + 1;
+        len += d->minSymLen;
+        buf64 <<= len;
+        buf64Size -= len;
+
+        if (buf64Size <= 32) {
+            buf64Size += 32;
+            buf64 |= uint64_t(readBE32(ptr)) << (64 - buf64Size);
+            ptr += 4;
+        }
+    }
+
+    // expand the pair tree down to the single value at offset
+    while (d->symlen[sym]) {
+        int left = d->symLeft(sym);
+        if (offset < d->symlen[left] + 1) {
+            sym = left;
+        }
+        else {
+            offset -= d->symlen[left] + 1;
+            sym = d->symRight(sym);
+        }
+    }
+    return d->symLeft(sym);
+}
+
+// dtz tables store moves or plies depending on flags, and values may be remapped
+int mapDtzScore(TBTable& t, int file, int value, WDLScore wdl) {
+    static const int wdlMap[] = { 1, 3, 0, 2, 0 };
+
+    PairsData* d = t.get(0, file);
+    if (d->flags & TB_MAPPED) {
+        int idx = d->mapIdx[wdlMap[wdl + 2]] + value;
+        value = d->flags & TB_WIDE ? readLE16(t.map + 2 * idx) : t.map[idx];
+    }
+
+    if ((wdl == WDL_WIN && !(d->flags & TB_WIN_PLIES))
+        || (wdl == WDL_LOSS && !(d->flags & TB_LOSS_PLIES))
+        || wdl == WDL_CURSED_WIN || wdl == WDL_BLESSED_LOSS)
+        value *= 2;
+
+    return value + 1;
+}
+
+// the board reduced to what the encoder needs
+struct TBPosition {
+    int side;
+    uint64_t key;
+    Bitboard occupied;
+    Bitboard pawns[2];
+    int pieceAt[64];   // 1..6 white pawn..king, 9..14 black, 0 empty
+};
+
+TBPosition tbPosition(const Board& board) {
+    TBPosition pos{};
+    int counts[2][6];
+
+    pos.side = board.getSide();
+    pos.occupied = board.getOccupancy(All);
+    for (int color = White; color <= Black; color++) {
+        pos.pawns[color] = board.getPieces(color, Pawn);
+        for (int piece = Pawn; piece <= King; piece++) {
+            Bitboard pieces = board.getPieces(color, piece);
+            counts[color][piece] = countBits(pieces);
+            while (pieces)
+                pos.pieceAt[popLSB(pieces)] = piece + 1 + 8 * color;
+        }
+    }
+    pos.key = materialKey(counts, false);
+    return pos;
+}
+
+int probeTable(const TBPosition& pos, TBTable& t, WDLScore wdl, ProbeState& state) {
+
+    int squares[SYZYGY_MAX_PIECES], pieces[SYZYGY_MAX_PIECES];
+    int size = 0, leadPawnsCount = 0, tbFile = 0;
+    Bitboard leadPawns = 0;
+
+    // tables are stored with the stronger side as white, and symmetric ones for
+    // white to move only; anything else is looked up with colors and ranks flipped
+    bool symmetricBlackToMove = t.key == t.key2 && pos.side == Black;
+    bool blackStronger = pos.key != t.key;
+    bool flip = symmetricBlackToMove || blackStronger;
+    int flipColor = flip * 8;
+    int flipSquares = flip * 56;
+    int stm = flip ^ pos.side;
+
+    // pawn tables are split by the file of the leading pawn
+    if (t.hasPawns) {
+        int piece = t.get(0, 0)->pieces[0] ^ flipColor;
+        Bitboard b = leadPawns = pos.pawns[piece >> 3];
+        while (b)
+            squares[size++] = popLSB(b) ^ flipSquares;
+
+        leadPawnsCount = size;
+        std::swap(squares[0], *std::max_element(squares, squares + leadPawnsCount, pawnsCompare));
+        tbFile = std::min(fileOf(squares[0]), 7 - fileOf(squares[0]));
+    }
+
+    // dtz tables only store one side to move
+    if (t.dtz && (t.get(stm, tbFile)->flags & TB_STM) != stm && !(t.key == t.key2 && !t.hasPawns)) {
+        state = PROBE_CHANGE_STM;
+        return 0;
+    }
+
+    Bitboard b = pos.occupied ^ leadPawns;
+    while (b) {
+        int square = popLSB(b);
+        squares[size] = square ^ flipSquares;
+        pieces[size++] = pos.pieceAt[square] ^ flipColor;
+    }
+
+    // reorder to the piece sequence of the table
+    PairsData* d = t.get(stm, tbFile);
+    for (int i = leadPawnsCount; i < size - 1; i++)
+        for (int j = i + 1; j < size; j++)
+            if (d->pieces[i] == pieces[j]) {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+
+    // leading piece into files a-d
+    if (fileOf(squares[0]) > 3)
+        for (int i = 0; i < size; i++)
+            squares[i] ^= 7;
+
+    uint64_t idx;
+    if (t.hasPawns) {
+        idx = leadPawnIdx[leadPawnsCount][squares[0]];
+        std::stable_sort(squares + 1, squares + leadPawnsCount, pawnsCompare);
+        for (int i = 1; i < leadPawnsCount; i++)
+            idx += binomial[i][mapPawns[squares[i]]];
+    }
+    else {
+        // leading piece into ranks 1-4, then below the a1-h8 diagonal
+        if (rankOf(squares[0]) > 3)
+            for (int i = 0; i < size; i++)
+                squares[i] ^= 56;
+
+        for (int i = 0; i < d->groupLen[0]; i++) {
+            if (!offA1H8(squares[i]))
+                continue;
+            if (offA1H8(squares[i]) > 0)
+                for (int j = i; j < size; j++)
+                    squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+            break;
+        }
+
+        if (t.hasUniquePieces) {
+            // three unique pieces encoded together, by how many sit on the diagonal
+            int adjust1 = squares[1] > squares[0];
+            int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+            if (offA1H8(squares[0]))
+                idx = (mapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62
+                    + squares[2] - adjust2;
+            else if (offA1H8(squares[1]))
+                idx = (6 * 63 + rankOf(squares[0]) * 28 + mapB1H1H7[squares[1]]) * 62
+                    + squares[2] - adjust2;
+            else if (offA1H8(squares[2]))
+                idx = 6 * 63 * 62 + 4 * 28 * 62
+                    + rankOf(squares[0]) * 7 * 28
+                    + (rankOf(squares[1]) - adjust1) * 28
+                    + mapB1H1H7[squares[2]];
+            else
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28
+                    + rankOf(squares[0]) * 6 * 7
+                    + (rankOf(squares[1]) - adjust1) * 6
+                    + (rankOf(squares[2]) - adjust2);
+        }
+        else {
+            idx = mapKK[mapA1D1D4[squares[0]]][squares[1]];
+        }
+    }
+
+    // remaining groups as combinations of the squares left by the previous ones
+    idx *= d->groupIdx[0];
+    int* groupSquares = squares + d->groupLen[0];
+    bool remainingPawns = t.hasPawns && t.pawnCount[1];
+
+    for (int next = 1; d->groupLen[next]; next++) {
+        std::stable_sort(groupSquares, groupSquares + d->groupLen[next]);
+
+        uint64_t n = 0;
+        for (int i = 0; i < d->groupLen[next]; i++) {
+            int adjust = static_cast<int>(std::count_if(squares, groupSquares,
+                [&](int s) { return groupSquares[i] > s; }));
+            n += binomial[i + 1][groupSquares[i] - adjust - 8 * remainingPawns];
+        }
+
+        remainingPawns = false;
+        idx += n * d->groupIdx[next];
+        groupSquares += d->groupLen[next];
+    }
+
+    int value = decompressPairs(d, idx);
+    return t.dtz ? mapDtzScore(t, tbFile, value, wdl) : value - 2;
+}
+
+int probeTable(const Board& board, bool dtz, ProbeState& state, WDLScore wdl = WDL_DRAW) {
+    TBPosition pos = tbPosition(board);
+
+    // bare kings have no table
+    if (countBits(pos.occupied) == 2)
+        return dtz ? 0 : WDL_DRAW;
+
+    auto it = tableIndex.find(pos.key);
+    TBTable* t = it == tableIndex.end() ? nullptr : dtz ? it->second.second : it->second.first;
+    if (!t || !mapTable(*t)) {
+        state = PROBE_FAIL;
+        return 0;
+    }
+    return probeTable(pos, *t, wdl, state);
+}
+
+// probe search //
+int dtzBeforeZeroing(WDLScore wdl) {
+    return wdl == WDL_WIN ? 1
+        : wdl == WDL_CURSED_WIN ? 101
+        : wdl == WDL_BLESSED_LOSS ? -101
+        : wdl == WDL_LOSS ? -1 : 0;
+}
+
+// tables don't know en passant and may store "don't care" values when a capture
+// (or a pawn move for dtz) is best, so those are searched before probing
+template <bool CheckZeroingMoves>
+WDLScore searchWDL(Board& board, ProbeState& state) {
+
+    WDLScore value, bestValue = WDL_LOSS;
+    MoveList moves = board.legalMoves();
+    size_t moveCount = 0;
+
+    for (size_t i = 0; i < moves.size(); i++) {
+        MoveStore m(moves[i]);
+        if (!m.isCapture() && (!CheckZeroingMoves || m.getPiece() != Pawn))
+            continue;
+        moveCount++;
+
+        BoardState saved;
+        board.copyState(saved);
+        board.makeMove(moves[i], ALL_MOVES);
+        value = static_cast<WDLScore>(-searchWDL<false>(board, state));
+        board.restoreState(saved);
+
+        if (state == PROBE_FAIL)
+            return WDL_DRAW;
+
+        if (value > bestValue) {
+            bestValue = value;
+            if (value >= WDL_WIN) {
+                state = PROBE_ZEROING_BEST_MOVE;
+                return value;
+            }
+        }
+    }
+
+    // every legal move was searched, the table value could be wrong (e.g. en passant)
+    bool noMoreMoves = moveCount && moveCount == moves.size();
+
+    if (noMoreMoves) {
+        value = bestValue;
+    }
+    else {
+        value = static_cast<WDLScore>(probeTable(board, false, state));
+        if (state == PROBE_FAIL)
+            return WDL_DRAW;
+    }
+
+    if (bestValue >= value) {
+        state = bestValue > WDL_DRAW || noMoreMoves ? PROBE_ZEROING_BEST_MOVE : PROBE_OK;
+        return bestValue;
+    }
+
+    state = PROBE_OK;
+    return value;
+}
+
+WDLScore probeWDL(Board& board, ProbeState& state) {
+    state = PROBE_OK;
+    return searchWDL<false>(board, state);
+}
+
+int probeDTZ(Board& board, ProbeState& state) {
+
+    state = PROBE_OK;
+    WDLScore wdl = searchWDL<true>(board, state);
+
+    // dtz tables don't store draws
+    if (state == PROBE_FAIL || wdl == WDL_DRAW)
+        return 0;
+
+    if (state == PROBE_ZEROING_BEST_MOVE)
+        return dtzBeforeZeroing(wdl);
+
+    int dtz = probeTable(board, true, state, wdl);
+    if (state == PROBE_FAIL)
+        return 0;
+
+    if (state != PROBE_CHANGE_STM)
+        return (dtz + 100 * (wdl == WDL_BLESSED_LOSS || wdl == WDL_CURSED_WIN)) * signOf(wdl);
+
+    // the table stores the other side to move: one ply search for the best dtz
+    int minDTZ = 0xFFFF;
+    MoveList moves = board.legalMoves();
+
+    for (size_t i = 0; i < moves.size(); i++) {
+        MoveStore m(moves[i]);
+        bool zeroing = m.isCapture() || m.getPiece() == Pawn;
+
+        BoardState saved;
+        board.copyState(saved);
+        board.makeMove(moves[i], ALL_MOVES);
+
+        // zeroing moves: the dtz before the move, signed by the result after it
+        dtz = zeroing ? -dtzBeforeZeroing(searchWDL<false>(board, state)) : -probeDTZ(board, state);
+
+        if (dtz == 1 && board.inCheck() && board.legalMoves().empty())
+            minDTZ = 1;
+
+        if (!zeroing)
+            dtz += signOf(dtz);
+
+        if (dtz < minDTZ && signOf(dtz) == signOf(wdl))
+            minDTZ = dtz;
+
+        board.restoreState(saved);
+
+        if (state == PROBE_FAIL)
+            return 0;
+    }
+
+    // no legal moves: mated
+    return minDTZ == 0xFFFF ? -1 : minDTZ;
+}
+
+bool probeable(const Board& board) {
+    return maxPieces && !board.getCastling() && countBits(board.getOccupancy(All)) <= maxPieces;
+}
+
+// "KRPvKR" -> piece counts, false if the name isn't a table
+bool parseTableName(const std::string& name, int counts[2][6]) {
+    static const std::string pieceChars = "PNBRQK";
+
+    memset(counts, 0, sizeof(int) * 12);
+    size_t split = name.find('v');
+    if (split == std::string::npos || name.size() > SYZYGY_MAX_PIECES + 1)
+        return false;
+
+    for (size_t i = 0; i < name.size(); i++) {
+        if (i == split)
+            continue;
+        size_t piece = pieceChars.find(name[i]);
+        if (piece == std::string::npos)
+            return false;
+        counts[i > split][piece]++;
+    }
+    return name[0] == 'K' && name[split + 1] == 'K' && counts[White][King] == 1 && counts[Black][King] == 1;
+}
+
+std::unique_ptr<TBTable> makeTable(const std::string& path, const int counts[2][6], bool dtz) {
+    auto t = std::make_unique<TBTable>();
+    t->dtz = dtz;
+    t->path = path;
+    t->key = materialKey(counts, false);
+    t->key2 = materialKey(counts, true);
+
+    for (int color = White; color <= Black; color++)
+        for (int piece = Pawn; piece <= King; piece++) {
+            t->pieceCount += counts[color][piece];
+            if (piece != King && counts[color][piece] == 1)
+                t->hasUniquePieces = true;
+        }
+    t->hasPawns = counts[White][Pawn] + counts[Black][Pawn] > 0;
+
+    // the leading color is the one with fewer (but some) pawns
+    bool whiteLeads = !counts[Black][Pawn]
+        || (counts[White][Pawn] && counts[Black][Pawn] >= counts[White][Pawn]);
+    t->pawnCount[0] = counts[whiteLeads ? White : Black][Pawn];
+    t->pawnCount[1] = counts[whiteLeads ? Black : White][Pawn];
+    return t;
+}
+
+} // namespace
+
+int syzygyInit(const std::string& paths) {
+    static std::once_flag encodingInit;
+    std::call_once(encodingInit, initEncodingTables);
+
+    // the new registry is built aside, probes keep using the old one until the swap
+    std::vector<std::unique_ptr<TBTable>> newTables;
+    std::unordered_map<uint64_t, std::pair<TBTable*, TBTable*>> newIndex;
+    int newMaxPieces = 0;
+    auto publish = [&] {
+        std::unique_lock<std::shared_mutex> lock(registryMutex);
+        tables.swap(newTables);
+        tableIndex.swap(newIndex);
+        maxPieces = newMaxPieces;
+    };
+
+    if (paths.empty() || paths == "<empty>") {
+        publish();
+        return 0;
+    }
+
+#ifdef _WIN32
+    const char separator = ';';
+#else
+    const char separator = ':';
+#endif
+
+    // table name -> file, the first directory listed wins
+    std::unordered_map<std::string, std::string> wdlFiles, dtzFiles;
+    size_t start = 0;
+    while (start <= paths.size()) {
+        size_t end = paths.find(separator, start);
+        if (end == std::string::npos)
+            end = paths.size();
+
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(paths.substr(start, end - start), error)) {
+            const auto& file = entry.path();
+            if (file.extension() == ".rtbw")
+                wdlFiles.emplace(file.stem().string(), file.string());
+            else if (file.extension() == ".rtbz")
+                dtzFiles.emplace(file.stem().string(), file.string());
+        }
+        start = end + 1;
+    }
+
+    int found = 0;
+    for (const auto& [name, path] : wdlFiles) {
+        int counts[2][6];
+        if (!parseTableName(name, counts))
+            continue;
+
+        TBTable* wdl = newTables.emplace_back(makeTable(path, counts, false)).get();
+        TBTable* dtz = nullptr;
+        auto dtzFile = dtzFiles.find(name);
+        if (dtzFile != dtzFiles.end()) {
+            dtz = newTables.emplace_back(makeTable(dtzFile->second, counts, true)).get();
+            found++;
+        }
+
+        newIndex[wdl->key] = { wdl, dtz };
+        newIndex[wdl->key2] = { wdl, dtz };
+        newMaxPieces = std::max(newMaxPieces, wdl->pieceCount);
+        found++;
+    }
+    publish();
+
+    logger.info("found " + std::to_string(found) + " tablebase files, up to "
+        + std::to_string(newMaxPieces) + " pieces");
+    return found;
+}
+
+int syzygyMaxPieces() {
+    return maxPieces;
+}
+
+WDLScore syzygyProbeWDL(Board& board, bool& ok) {
+    ok = false;
+    if (!probeable(board))
+        return WDL_DRAW;
+
+    std::shared_lock<std::shared_mutex> lock(registryMutex);
+    ProbeState state;
+    WDLScore wdl = probeWDL(board, state);
+    ok = state != PROBE_FAIL;
+    return wdl;
+}
+
+int syzygyProbeDTZ(Board& board, bool& ok) {
+    ok = false;
+    if (!probeable(board))
+        return 0;
+
+    std::shared_lock<std::shared_mutex> lock(registryMutex);
+    ProbeState state;
+    int dtz = probeDTZ(board, state);
+    ok = state != PROBE_FAIL;
+    return dtz;
+}
+
+bool syzygyFilterRootMoves(Board& board, MoveList& moves) {
+    if (!probeable(board) || moves.empty())
+        return false;
+    std::shared_lock<std::shared_mutex> lock(registryMutex);
+
+    // dtz counted from the root: quick wins first, then cursed wins, draws,
+    // blessed losses and finally the slowest losses
+    int ranks[256];
+    int bestRank = -1000000;
+    int clock = board.getHalfmoveClock();
+
+    for (size_t i = 0; i < moves.size(); i++) {
+        MoveStore m(moves[i]);
+        ProbeState state;
+        int dtz;
+
+        BoardState saved;
+        board.copyState(saved);
+        board.makeMove(moves[i], ALL_MOVES);
+
+        if (m.isCapture() || m.getPiece() == Pawn) {
+            dtz = dtzBeforeZeroing(static_cast<WDLScore>(-probeWDL(board, state)));
+        }
+        else {
+            dtz = -probeDTZ(board, state);
+            dtz += signOf(dtz);
+        }
+
+        // a mating move
+        if (dtz == 2 && board.inCheck() && board.legalMoves().empty())
+            dtz = 1;
+
+        board.restoreState(saved);
+        if (state == PROBE_FAIL)
+            return false;
+
+        // with the plies already played a win may no longer convert in time (and a loss
+        // may be saved), rank those as cursed wins / blessed losses
+        if (!(m.isCapture() || m.getPiece() == Pawn) && std::abs(dtz) + clock > 100)
+            dtz += signOf(dtz) * clock;
+
+        ranks[i] = dtz > 0 ? 10000 - dtz : dtz < 0 ? -10000 - dtz : 0;
+        bestRank = std::max(bestRank, ranks[i]);
+    }
+
+    MoveList kept;
+    for (size_t i = 0; i < moves.size(); i++)
+        if (ranks[i] == bestRank)
+            kept.add(moves[i]);
+    moves = kept;
+    return true;
+}
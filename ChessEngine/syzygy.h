@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+
+#include "chess.h"
+
+// Syzygy endgame tablebases: .rtbw (win/draw/loss) and .rtbz (distance to zeroing)
+// files are found at init, memory-mapped on their first probe and shared read-only
+
+constexpr int SYZYGY_MAX_PIECES = 7;
+
+enum WDLScore : int {
+    WDL_LOSS = -2,          // loss
+    WDL_BLESSED_LOSS = -1,  // loss, but draw under the 50-move rule
+    WDL_DRAW = 0,
+    WDL_CURSED_WIN = 1,     // win, but draw under the 50-move rule
+    WDL_WIN = 2
+};
+
+// directories separated by ';' on windows and ':' elsewhere, returns the number
+// of tables found; an empty string unloads everything. Probes on other threads wait for
+// the new tables while they are swapped in
+int syzygyInit(const std::string& paths);
+
+// largest piece count (kings included) covered by the loaded tables, 0 if none
+int syzygyMaxPieces();
+
+// probes fail (ok = false) with castling rights, too many pieces or a missing file;
+// en passant is handled by searching the captures before probing
+WDLScore syzygyProbeWDL(Board& board, bool& ok);
+
+// plies to the next capture or pawn move with optimal play, negative when losing,
+// values beyond +-100 are cursed wins / blessed losses
+int syzygyProbeDTZ(Board& board, bool& ok);
+
+// reduce the legal root moves to those that keep the tablebase result: the fastest
+// conversion when winning, every drawing move, the longest resistance when losing
+bool syzygyFilterRootMoves(Board& board, MoveList& moves);
@@ -0,0 +1,82 @@
+#include "tensor.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TENSOR_SSE2
+#include <emmintrin.h>
+#endif
+
+// bitboard -> 64 values of 0 / 1 //
+#if defined(TENSOR_SSE2)
+
+// byte masks of two ranks: every byte of the rank spread over 8 lanes, compared
+// against its own bit
+static inline __m128i rankPairMask(Bitboard bitboard, int pair) {
+    const __m128i bits = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+    __m128i v = _mm_cvtsi32_si128(static_cast<int>((bitboard >> (16 * pair)) & 0xffff));
+    v = _mm_unpacklo_epi8(v, v);
+    v = _mm_unpacklo_epi16(v, v);
+    v = _mm_unpacklo_epi32(v, v);
+    return _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits);
+}
+
+static inline void expandBits(Bitboard bitboard, uint8_t* out) {
+    const __m128i one = _mm_set1_epi8(1);
+    for (int pair = 0; pair < 4; pair++)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16 * pair), _mm_and_si128(rankPairMask(bitboard, pair), one));
+}
+
+static inline void expandBits(Bitboard bitboard, float* out) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (int pair = 0; pair < 4; pair++) {
+        __m128i mask = rankPairMask(bitboard, pair);
+        __m128i low = _mm_unpacklo_epi8(mask, mask);
+        __m128i high = _mm_unpackhi_epi8(mask, mask);
+        float* dst = out + 16 * pair;
+        _mm_storeu_ps(dst, _mm_and_ps(_mm_castsi128_ps(_mm_unpacklo_epi16(low, low)), one));
+        _mm_storeu_ps(dst + 4, _mm_and_ps(_mm_castsi128_ps(_mm_unpackhi_epi16(low, low)), one));
+        _mm_storeu_ps(dst + 8, _mm_and_ps(_mm_castsi128_ps(_mm_unpacklo_epi16(high, high)), one));
+        _mm_storeu_ps(dst + 12, _mm_and_ps(_mm_castsi128_ps(_mm_unpackhi_epi16(high, high)), one));
+    }
+}
+
+#else
+
+template <typename T>
+static inline void expandBits(Bitboard bitboard, T* out) {
+    for (int square = 0; square < 64; square++)
+        out[square] = static_cast<T>((bitboard >> square) & 1);
+}
+
+#endif
+
+template <typename T>
+static void encode(const Board& board, T* out, bool attacks) {
+    for (int color = White; color <= Black; color++)
+        for (int piece = Pawn; piece <= King; piece++)
+            expandBits(board.getPieces(color, piece), out + 64 * (6 * color + piece));
+
+    // constant planes
+    const Bitboard full = ~0ULL;
+    int castling = board.getCastling();
+    expandBits(board.getSide() == White ? full : 0ULL, out + 64 * 12);
+    expandBits(castling & wk ? full : 0ULL, out + 64 * 13);
+    expandBits(castling & wq ? full : 0ULL, out + 64 * 14);
+    expandBits(castling & bk ? full : 0ULL, out + 64 * 15);
+    expandBits(castling & bq ? full : 0ULL, out + 64 * 16);
+
+    int enpassant = board.getEnpassant();
+    expandBits(enpassant != no_sq ? 1ULL << enpassant : 0ULL, out + 64 * 17);
+
+    if (attacks) {
+        expandBits(board.attackedSquares(White), out + 64 * TENSOR_PLANES);
+        expandBits(board.attackedSquares(Black), out + 64 * (TENSOR_PLANES + 1));
+    }
+}
+
+void encodeBoard(const Board& board, float* out, bool attacks) {
+    encode(board, out, attacks);
+}
+
+void encodeBoard(const Board& board, uint8_t* out, bool attacks) {
+    encode(board, out, attacks);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+
+#include "chess.h"
+
+// board -> network input planes of 8x8, written as (C, 8, 8) with square = rank * 8 + file
+// (plane[0][0] is a1), from white's point of view whatever the side to move:
+//
+//   0-5    white pawn, knight, bishop, rook, queen, king
+//   6-11   black pawn .. king
+//   12     side to move, all ones when white is to move
+//   13-16  castling rights K, Q, k, q, all ones when available
+//   17     en passant target square
+//   18-19  squares attacked by white / black (only with attacks)
+
+constexpr int TENSOR_PLANES = 18;
+constexpr int TENSOR_ATTACK_PLANES = 2;
+
+inline int tensorPlanes(bool attacks) {
+    return TENSOR_PLANES + (attacks ? TENSOR_ATTACK_PLANES : 0);
+}
+
+// out holds tensorPlanes(attacks) * 64 values, every one of them is written
+void encodeBoard(const Board& board, float* out, bool attacks);
+void encodeBoard(const Board& board, uint8_t* out, bool attacks);
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "chess.h"
+
+// move generator and board representation regression check, run by ctest:
+//   perft node counts of the standard test positions,
+//   GEN_CAPTURES and GEN_QUIETS partition GEN_ALL,
+//   the legal moves among GEN_EVASIONS are the legal moves among GEN_ALL,
+//   the mailbox agrees with the bitboards,
+// the last three on every position of random games from the same start positions
+
+struct PerftCase {
+    const char* fen;
+    int depth;
+    uint64_t nodes;
+};
+
+static const PerftCase perftCases[] = {
+    { START_FEN, 5, 4865609 },
+    { "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603 },
+    { "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624 },
+    { "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333 },
+    { "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487 },
+    { "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594 },
+};
+
+constexpr int RANDOM_GAMES = 50;
+constexpr int RANDOM_PLIES = 200;
+
+static std::vector<Move> generated(Board& board, GenType type) {
+    MoveList moveList;
+    board.generateMoves(moveList, type);
+    std::vector<Move> moves;
+    for (size_t i = 0; i < moveList.size(); i++)
+        moves.push_back(moveList[i]);
+    std::sort(moves.begin(), moves.end());
+    return moves;
+}
+
+static std::vector<Move> legalOnly(Board& board, const std::vector<Move>& moves) {
+    std::vector<Move> legal;
+    for (Move move : moves) {
+        BoardState state;
+        board.copyState(state);
+        if (board.makeMove(move, ALL_MOVES))
+            legal.push_back(move);
+        board.restoreState(state);
+    }
+    return legal;
+}
+
+static bool mailboxMatches(const Board& board) {
+    for (int square = a1; square <= h8; square++) {
+        int expected = -1;
+        for (int color = White; color <= Black; color++)
+            for (int piece = Pawn; piece <= King; piece++)
+                if (board.getPieces(color, piece) & (1ULL << square))
+                    expected = piece;
+        if (board.pieceOn(square) != expected)
+            return false;
+    }
+    return true;
+}
+
+// 0 if the position passes, otherwise a description of the first failed check
+static const char* checkPosition(Board& board) {
+    std::vector<Move> all = generated(board, GEN_ALL);
+    std::vector<Move> split = generated(board, GEN_CAPTURES);
+    std::vector<Move> quiets = generated(board, GEN_QUIETS);
+    split.insert(split.end(), quiets.begin(), quiets.end());
+    std::sort(split.begin(), split.end());
+    if (split != all)
+        return "captures + quiets != all";
+    if (legalOnly(board, generated(board, GEN_EVASIONS)) != legalOnly(board, all))
+        return "legal evasions != legal moves";
+    if (!mailboxMatches(board))
+        return "mailbox does not match the bitboards";
+    return nullptr;
+}
+
+int main() {
+    Board board;
+    int failures = 0;
+
+    for (const PerftCase& test : perftCases) {
+        board.parseFEN(test.fen);
+        uint64_t nodes = board.perft_driver(test.depth);
+        bool ok = nodes == test.nodes;
+        failures += !ok;
+        printf("%s perft %d %llu (expected %llu) %s\n", ok ? "ok  " : "FAIL", test.depth,
+            (unsigned long long)nodes, (unsigned long long)test.nodes, test.fen);
+    }
+
+    std::mt19937 rng(1);
+    size_t positions = 0;
+    int generatorFailures = 0;
+    for (int game = 0; game < RANDOM_GAMES; game++) {
+        board.parseFEN(perftCases[game % (sizeof(perftCases) / sizeof(perftCases[0]))].fen);
+        for (int ply = 0; ply < RANDOM_PLIES; ply++) {
+            positions++;
+            if (const char* error = checkPosition(board)) {
+                printf("FAIL %s: %s\n", error, board.toFEN().c_str());
+                generatorFailures++;
+                break;
+            }
+            MoveList legal = board.legalMoves();
+            if (legal.empty())
+                break;
+            board.makeMove(legal[rng() % legal.size()], ALL_MOVES);
+        }
+    }
+    failures += generatorFailures;
+    printf("%s generator checks on %zu positions\n", generatorFailures ? "FAIL" : "ok  ", positions);
+
+    return failures ? 1 : 0;
+}
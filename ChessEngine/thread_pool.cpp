@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <utility>
+
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(int threads) {
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // the calling thread works too
+    for (int i = 1; i < threads; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        exiting = true;
+    }
+    cv.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+// the first exception is kept for parallelFor and no further chunks are handed out, the
+// ones already running finish
+void ThreadPool::runChunks() {
+    while (true) {
+        size_t begin = nextIndex.fetch_add(jobGrain, std::memory_order_relaxed);
+        if (begin >= jobCount)
+            return;
+        try {
+            (*job)(begin, std::min(begin + jobGrain, jobCount));
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!jobError)
+                jobError = std::current_exception();
+            nextIndex = jobCount;
+        }
+    }
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return exiting || generation != seen; });
+            if (exiting)
+                return;
+            seen = generation;
+        }
+
+        runChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy--;
+        }
+        doneCv.notify_one();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn) {
+    if (!count)
+        return;
+    grain = std::max<size_t>(grain, 1);
+
+    // not worth waking anyone
+    if (workers.empty() || count <= grain) {
+        fn(0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit(submitMutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        jobCount = count;
+        jobGrain = grain;
+        nextIndex = 0;
+        jobError = nullptr;
+        busy = static_cast<int>(workers.size());
+        generation++;
+    }
+    cv.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCv.wait(lock, [this] { return busy == 0; });
+    job = nullptr;
+    if (jobError)
+        std::rethrow_exception(std::exchange(jobError, nullptr));
+}
+
+namespace {
+std::mutex globalMutex;
+std::shared_ptr<ThreadPool> globalPool;
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::global() {
+    std::lock_guard<std::mutex> lock(globalMutex);
+    if (!globalPool)
+        globalPool = std::make_shared<ThreadPool>();
+    return globalPool;
+}
+
+void ThreadPool::setGlobalThreads(int threads) {
+    auto pool = std::make_shared<ThreadPool>(threads);
+    std::lock_guard<std::mutex> lock(globalMutex);
+    globalPool = std::move(pool);
+}
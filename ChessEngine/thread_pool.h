@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// persistent worker threads for data-parallel batch work: parallelFor splits an
+// index range into chunks that the workers and the calling thread pull until done
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads = 0);   // 0 = one per hardware thread
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    // fn(begin, end) over [0, count) in chunks of at most `grain`, blocks until all
+    // chunks are done; calls from several threads are serialized. If fn throws, the
+    // chunks not yet started are skipped and the first exception is rethrown here
+    // once every thread is out of fn
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+    // shared pool used by the batch APIs; callers hold on to it for the duration of a
+    // job, so resizing never pulls a pool from under a running batch
+    static std::shared_ptr<ThreadPool> global();
+    static void setGlobalThreads(int threads);
+
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex submitMutex;          // one job at a time
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::condition_variable doneCv;
+    const std::function<void(size_t, size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    size_t jobGrain = 1;
+    std::atomic<size_t> nextIndex{ 0 };
+    std::exception_ptr jobError;     // first exception thrown by the current job
+    uint64_t generation = 0;
+    int busy = 0;                    // workers still inside the current job
+    bool exiting = false;
+
+    void workerLoop();
+    void runChunks();
+};
@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#include "book.h"
+#include "chess.h"
+#include "logger.h"
+#include "search.h"
+#include "syzygy.h"
+
+// UCI front end: the input loop stays responsive while the search runs on its own threads
+
+constexpr auto ENGINE_NAME = "ChessEngine";
+
+// search threads and the input loop both write to stdout
+static std::mutex outputMutex;
+
+static void send(const std::string& line) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << line << std::endl;
+}
+
+// position [startpos | fen <fen>] [moves <move> ...]
+static void parsePosition(Board& board, std::istringstream& input) {
+    std::string token, fen;
+    input >> token;
+
+    if (token == "startpos") {
+        fen = START_FEN;
+        input >> token;
+    }
+    else if (token == "fen") {
+        while (input >> token && token != "moves")
+            fen += token + " ";
+    }
+    else {
+        return;
+    }
+
+    FENError error = board.parseFEN(fen);
+    if (error != FEN_OK) {
+        send(std::string("info string invalid fen: ") + fenErrorString(error));
+        return;
+    }
+
+    if (token != "moves")
+        return;
+
+    while (input >> token) {
+        Move move = board.parseMove(token);
+        if (!move || !board.makeMove(move, ALL_MOVES)) {
+            send("info string illegal move " + token);
+            return;
+        }
+    }
+}
+
+// go [wtime x] [btime x] [winc x] [binc x] [movestogo x] [depth x] [nodes x] [movetime x] [infinite] [ponder]
+static SearchLimits parseGo(std::istringstream& input, int multiPV) {
+    SearchLimits limits;
+    limits.multiPV = multiPV;
+    std::string token;
+
+    while (input >> token) {
+        if (token == "wtime") input >> limits.time[White];
+        else if (token == "btime") input >> limits.time[Black];
+        else if (token == "winc") input >> limits.inc[White];
+        else if (token == "binc") input >> limits.inc[Black];
+        else if (token == "movestogo") input >> limits.movestogo;
+        else if (token == "depth") input >> limits.depth;
+        else if (token == "nodes") input >> limits.nodes;
+        else if (token == "movetime") input >> limits.movetime;
+        else if (token == "infinite") limits.infinite = true;
+        else if (token == "ponder") limits.ponder = true;
+    }
+    if (limits.depth >= MAX_PLY)
+        limits.depth = MAX_PLY - 1;
+    return limits;
+}
+
+// spin option value clamped to [min, max], false (with a message) if it is not a number
+static bool parseSpin(const std::string& name, const std::string& value, int min, int max, int& out) {
+    int number;
+    auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), number);
+    if (error == std::errc::result_out_of_range) {
+        number = value[0] == '-' ? min : max;
+    }
+    else if (error != std::errc() || end != value.data() + value.size()) {
+        send("info string invalid value for " + name + ": " + value);
+        return false;
+    }
+    out = std::clamp(number, min, max);
+    return true;
+}
+
+// setoption name <id> [value <x>]; options that resize the search or replace the network,
+// tablebases or book are only changed with no search running, a running one is stopped
+static void setOption(Search& search, bool& ownBook, int& multiPV, std::istringstream& input) {
+    std::string token, name, value;
+    input >> token;
+
+    while (input >> token && token != "value")
+        name += (name.empty() ? "" : " ") + token;
+    while (input >> token)
+        value += (value.empty() ? "" : " ") + token;
+
+    int number;
+    if (name == "Hash") {
+        if (parseSpin(name, value, 1, 65536, number)) {
+            search.stop();
+            search.setHash(number);
+        }
+    }
+    else if (name == "Threads") {
+        if (parseSpin(name, value, 1, 256, number)) {
+            search.stop();
+            search.setThreads(number);
+        }
+    }
+    else if (name == "EvalFile") {
+        search.stop();
+        search.wait();
+        if (!nnueLoad(value))
+            send("info string could not load " + value);
+    }
+    else if (name == "SyzygyPath") {
+        search.stop();
+        search.wait();
+        int found = syzygyInit(value);
+        send("info string found " + std::to_string(found) + " tablebase files, up to "
+            + std::to_string(syzygyMaxPieces()) + " pieces");
+    }
+    else if (name == "MultiPV") {
+        if (parseSpin(name, value, 1, 256, number))
+            multiPV = number;
+    }
+    else if (name == "OwnBook") {
+        ownBook = value == "true";
+    }
+    else if (name == "BookFile") {
+        search.stop();
+        search.wait();
+        if (!bookInit(value))
+            send("info string could not load " + value);
+    }
+    else if (name != "Ponder") {
+        send("info string unknown option " + name);
+    }
+}
+
+static std::string pvToString(const std::vector<Move>& pv) {
+    std::string str;
+    for (Move move : pv)
+        str += " " + moveToString(move);
+    return str;
+}
+
+int main() {
+
+    // keep debug/info messages off the protocol stream
+    logger.setLevel(Logger::Level::ERRORS);
+
+    Board board;
+    board.parseFEN(START_FEN);
+
+    Search search;
+    bool ownBook = false;
+    int multiPV = 1;
+    double pawnHitRate = 0.0;
+
+    search.onInfo = [&](const SearchInfo& info) {
+        uint64_t nps = info.time ? info.nodes * 1000 / info.time : 0;
+        pawnHitRate = info.pawnHitRate;
+        send("info depth " + std::to_string(info.depth)
+            + " multipv " + std::to_string(info.multiPV)
+            + " score " + scoreToString(info.score)
+            + " nodes " + std::to_string(info.nodes)
+            + " nps " + std::to_string(nps)
+            + " hashfull " + std::to_string(info.hashfull)
+            + " tbhits " + std::to_string(info.tbHits)
+            + " time " + std::to_string(info.time)
+            + " pv" + pvToString(info.pv));
+    };
+
+    search.onBestMove = [&](const SearchResult& result) {
+        send("info string pawn hash hit rate " + std::to_string(static_cast<int>(pawnHitRate * 100)) + "%");
+        if (STATS_ENABLED) {
+            SearchStats stats = search.stats();
+            std::string ebf;
+            for (double factor : stats.branchingFactor)
+                ebf += " " + std::to_string(factor).substr(0, 4);
+            send("info string stats nodes " + std::to_string(stats.nodes)
+                + " qnodes " + std::to_string(stats.qnodes)
+                + " tthits " + std::to_string(stats.ttHits) + "/" + std::to_string(stats.ttProbes)
+                + " ttcuts " + std::to_string(stats.ttCutoffs)
+                + " firstcuts " + std::to_string(stats.firstMoveCutoffs) + "/" + std::to_string(stats.betaCutoffs)
+                + " nullcuts " + std::to_string(stats.nullMoveCutoffs) + "/" + std::to_string(stats.nullMoveTries)
+                + " lmrresearches " + std::to_string(stats.lmrResearches) + "/" + std::to_string(stats.lmrReductions)
+                + " ebf" + ebf);
+        }
+        std::string line = "bestmove " + (result.bestMove ? moveToString(result.bestMove) : std::string("0000"));
+        if (result.ponderMove)
+            line += " ponder " + moveToString(result.ponderMove);
+        send(line);
+    };
+
+    std::string line, command;
+    while (std::getline(std::cin, line)) {
+        std::istringstream input(line);
+        command.clear();
+        input >> command;
+
+        if (command == "uci") {
+            send(std::string("id name ") + ENGINE_NAME);
+            send("id author ChessEngine developers");
+            send("option name Hash type spin default 16 min 1 max 65536");
+            send("option name Threads type spin default 1 min 1 max 256");
+            send("option name MultiPV type spin default 1 min 1 max 256");
+            send("option name Ponder type check default false");
+            send("option name EvalFile type string default <empty>");
+            send("option name SyzygyPath type string default <empty>");
+            send("option name OwnBook type check default false");
+            send("option name BookFile type string default <empty>");
+            send("uciok");
+        }
+        else if (command == "isready") {
+            send("readyok");
+        }
+        else if (command == "ucinewgame") {
+            search.stop();
+            search.clear();
+        }
+        else if (command == "position") {
+            search.stop();
+            search.wait();
+            parsePosition(board, input);
+        }
+        else if (command == "go") {
+            SearchLimits limits = parseGo(input, multiPV);
+
+            // book moves are played instantly, except when the GUI expects the search to keep running
+            Move move = ownBook && !limits.infinite && !limits.ponder ? bookMove(board) : 0;
+            if (move)
+                send("bestmove " + moveToString(move));
+            else
+                search.start(board, limits);
+        }
+        else if (command == "stop") {
+            search.stop();
+        }
+        else if (command == "ponderhit") {
+            search.ponderhit();
+        }
+        else if (command == "setoption") {
+            setOption(search, ownBook, multiPV, input);
+        }
+        else if (command == "d") {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            board.printBoard();
+        }
+        else if (command == "quit") {
+            break;
+        }
+    }
+
+    search.stop();
+    search.wait();
+    return 0;
+}